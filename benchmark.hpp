@@ -7,6 +7,15 @@
 // License: BSL-1.0
 // https://github.com/yurablok/cpp-adaptive-benchmark
 // History:
+// v0.8 2026-Oct-17     Added instrumentation zones, latency recorder and timeline.
+// v0.7 2026-Oct-17     Added histogram, open-loop load, trace replay, sample log,
+//                      streaming statistics, soak and macro benchmarks.
+// v0.6 2026-Oct-17     Added layout randomization, contention probe, core-to-core
+//                      latency, interference and co-run matrix.
+// v0.5 2026-Oct-17     Added linear regression estimator, instruction benchmark,
+//                      ISA variants, offset sweep and branch patterns.
+// v0.4 2026-Oct-17     Added working set sweep, memory probe, roofline, placements
+//                      and throughput.
 // v0.3 2023-Feb-04     Added picosecond accuracy and min, max, avg statistics.
 // v0.2 2023-Jan-19     Added nanosecond accuracy on Windows.
 // v0.1 2022-Apr-21     First release.
@@ -17,8 +26,54 @@
 #include <vector>
 #include <string>
 #include <functional>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
 #include <iomanip>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <cmath>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+# define ADAPTIVE_BENCHMARK_X86
+# ifdef _MSC_VER
+#  include <intrin.h>
+# else
+#  include <cpuid.h>
+# endif
+#endif
+#if defined(__GNUC__) || defined(__clang__)
+# define ADAPTIVE_BENCHMARK_FORCEINLINE inline __attribute__((always_inline))
+#elif defined(_MSC_VER)
+# define ADAPTIVE_BENCHMARK_FORCEINLINE __forceinline
+#else
+# define ADAPTIVE_BENCHMARK_FORCEINLINE inline
+#endif
+#ifdef __linux__
+# include <sched.h>
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <sys/ioctl.h>
+# include <sys/wait.h>
+# include <sys/resource.h>
+# include <unistd.h>
+# include <fcntl.h>
+# include <alloca.h>
+# include <linux/perf_event.h>
+# include <malloc.h>
+#endif // __linux__
+#ifdef _WIN32
+# include <malloc.h>
+#endif // _WIN32
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# include <emmintrin.h>
+# define ADAPTIVE_BENCHMARK_SSE2
+#endif
 
 
 
@@ -27,12 +82,533 @@ public:
     // number: 1..10
     void setColumnsNumber(const uint8_t number);
 
+    // Title of the column in the tables instead of "Time".
+    void setColumnName(const uint8_t column, std::string name);
+
     // column: 0..number-1
     void add(std::string name, const uint8_t column,
         std::function<uint32_t(uint32_t random)> testee);
 
+    enum class Isa : uint8_t {
+        Generic, // target of the build
+        SSE42,   // x86: SSE4.2, POPCNT
+        AVX2,    // x86: AVX2, FMA, BMI1, BMI2
+        AVX512,  // x86: AVX-512 F, BW, DQ, VL
+        _count
+    };
+    // CPUID and XGETBV on x86, Generic only on other architectures.
+    static bool isSupported(const Isa isa) noexcept;
+    static const char* toString(const Isa isa) noexcept;
+
+    // Uses columns 0..3 as ISA variants, see ADAPTIVE_BENCHMARK_ADD_ISA_VARIANTS.
+    // Variants unsupported by the CPU are left empty and reported as Noop.
+    void addIsaVariant(const std::string& name, const Isa isa,
+        std::function<uint32_t(uint32_t random)> testee);
+
+    // Declares the work of one call for the roofline section of run().
+    // opsPerCall: floating-point or integer operations
+    // bytesPerCall: memory traffic
+    void setWork(const std::string& name, const uint8_t column, const double opsPerCall,
+        const double bytesPerCall, const bool integerOps = false);
+
+    enum class Estimator : uint8_t {
+        Batch,      // batch time divided by the number of calls
+        Regression, // time = a + b * calls fitted over linearly growing batches
+    };
+    // Estimator of the main measurement, Batch by default.
+    void setEstimator(const Estimator estimator);
+
+    // Bounded memory statistics of the per-call time of each main measurement
+    // batch: Welford's mean and variance, a reservoir of `reservoirSize`
+    // samples for the median and its bootstrap CI95, and P² sketches of the
+    // p50, p90 and p99. Printed by run(), 0 - off.
+    void setStreamingStatistics(const uint32_t reservoirSize = 65536);
+
     void run(const uint32_t timePerTestee_s = 5, const uint32_t minimumRepetitions = 500);
 
+    // setup: prepares a working set of the given size before it is measured
+    // bytesPerCall: memory traffic of one testee call, used for bytes/s
+    void addWorkingSet(std::string name, std::function<void(size_t size_B)> setup,
+        std::function<uint32_t(uint32_t random)> testee, const uint32_t bytesPerCall = 64);
+
+    // Sweeps working set sizes from a quarter of L1 up to `llcFactor` times LLC
+    // with 2 steps per doubling.
+    void runWorkingSetSweep(const uint32_t timePerSize_s = 1, const uint32_t llcFactor = 4,
+        const uint32_t minimumRepetitions = 500);
+
+    struct CacheLevel {
+        uint8_t level = 0;
+        uint64_t size_B = 0;
+        uint32_t lineSize_B = 64;
+    };
+    // Data and unified caches of the first CPU, sorted by level.
+    // Linux: /sys/devices/system/cpu/cpu0/cache
+    // Others: typical 32KiB, 256KiB, 8MiB
+    static std::vector<CacheLevel> getCacheLevels();
+
+    enum class Backing : uint8_t {
+        Normal,               // madvise(MADV_NOHUGEPAGE) on Linux
+        TransparentHugePages, // madvise(MADV_HUGEPAGE) on 2MiB-aligned memory, THP not "never"
+        HugeTLB,              // MAP_HUGETLB, needs reserved huge pages
+    };
+    // Page-aligned zeroed memory with selectable backing and NUMA node.
+    class Buffer {
+    public:
+        Buffer() = default;
+        // numaNode: -1 - any
+        Buffer(const size_t size_B, const Backing backing = Backing::Normal,
+            const int32_t numaNode = -1);
+        Buffer(Buffer&& other) noexcept;
+        Buffer& operator=(Buffer&& other) noexcept;
+        Buffer(const Buffer&) = delete;
+        Buffer& operator=(const Buffer&) = delete;
+        ~Buffer();
+
+        uint8_t* data() const noexcept {
+            return m_data;
+        }
+        size_t size() const noexcept {
+            return m_size_B;
+        }
+        // false if the backing or the NUMA node is not available
+        explicit operator bool() const noexcept {
+            return m_data != nullptr;
+        }
+        // Normal: transparent huge pages could not be excluded.
+        bool mayUseHugePages() const noexcept {
+            return m_mayUseHugePages;
+        }
+    private:
+        void release() noexcept;
+        bool m_mayUseHugePages = false;
+        uint8_t* m_data = nullptr;
+        size_t m_size_B = 0;
+        size_t m_allocated_B = 0;
+        void* m_allocation = nullptr;
+    };
+    // Linux: /sys/devices/system/node/online
+    // Others: single node 0
+    static std::vector<uint32_t> getNumaNodes();
+
+    // setup: fills the harness-managed buffer before it is measured
+    void addPlacement(std::string name, const size_t size_B,
+        std::function<void(uint8_t* data, size_t size_B)> setup,
+        std::function<uint32_t(uint32_t random)> testee);
+
+    // Runs each placement testee on Normal, THP and HugeTLB buffers bound to
+    // each NUMA node, as columns. Unavailable placements are reported as Noop.
+    void runPlacements(const uint32_t timePerTestee_s = 5,
+        const uint32_t minimumRepetitions = 500);
+
+    // Latency and reciprocal throughput of `op` in cycles, measured by unrolled
+    // dependent chains and 8 independent streams of 256 and 512 operations.
+    // The difference between the two lengths cancels the call and loop overhead.
+    // T: integer, floating-point or SIMD type
+    // op: T(T x, T y), applied as x = op(x, y) starting from the given values
+    template <typename T, typename Op>
+    void addInstruction(std::string name, Op op, const T x, const T y);
+
+    // A chain of 64-bit additions is used as 1 cycle.
+    void runInstructions(const uint32_t timePerTestee_s = 1,
+        const uint32_t minimumRepetitions = 500);
+
+    enum class Misalign : uint8_t {
+        Input,  // output stays page-aligned, so 4K aliasing shows at offset 0
+        Output, // input stays page-aligned
+        Both,
+    };
+    // testee: processes `size_B` bytes from input to output, both are
+    // page-aligned plus the offset of the sweep. The input holds random bytes.
+    void addOffsetSweep(std::string name, const size_t size_B, const Misalign misalign,
+        std::function<uint32_t(uint32_t random, const uint8_t* input, uint8_t* output)> testee);
+
+    // Offsets 0, step, ..., maxOffset - step, e.g. 64 and 1 for a cache line,
+    // 4096 and 64 for a page.
+    void runOffsetSweep(const uint32_t timePerOffset_s = 1, const uint32_t maxOffset = 64,
+        const uint32_t step = 1, const uint32_t minimumRepetitions = 500);
+
+    enum class BranchPattern : uint8_t {
+        AllSame,  // always taken
+        Periodic, // taken once per period
+        Markov,   // repeats the previous outcome, else taken with the probability
+        Random,
+        _count,
+    };
+    // testee: branches on each of the `count` outcomes, 0 - not taken, 1 - taken.
+    void addBranchPatterns(std::string name, const uint32_t count,
+        std::function<uint32_t(uint32_t random, const uint8_t* taken, uint32_t count)> testee);
+
+    // Time per outcome for each pattern as columns, with branch misses per
+    // outcome where hardware counters are available (Linux perf events).
+    // The cost of the harness wrapper around each call is subtracted.
+    // Markov is taken with `takenProbability` on average. Markov and Random
+    // outcomes start at a random offset of a buffer of at least 64Ki outcomes
+    // per call, so a predictor cannot learn them by heart.
+    void runBranchPatterns(const uint32_t timePerPattern_s = 1, const uint32_t period = 16,
+        const double takenProbability = 0.5, const double repeatProbability = 0.9,
+        const uint32_t minimumRepetitions = 500);
+
+    enum class Layout : uint8_t {
+        InProcess, // stack and heap offsets
+        Exec,      // also environment size and ASLR by re-executing the program
+    };
+    // Reruns the testees of run() under `layouts` randomized layouts, each testee
+    // for `timePerLayout_s`: stack offset below the measurement loop and a heap
+    // offset, passed to `relocate` to reallocate the inputs. Layout::Exec
+    // measures each layout in a child started from /proc/self/exe with the same
+    // arguments, so the program must register the same testees and reach this
+    // call before other long runs.
+    void runLayouts(const uint32_t layouts = 10, const Layout layout = Layout::InProcess,
+        const uint32_t timePerLayout_s = 1, const uint32_t minimumRepetitions = 500,
+        std::function<void(size_t heapOffset_B)> relocate = nullptr);
+
+    enum class Access : uint8_t {
+        Read,
+        Write,
+        Rmw, // atomic fetch_add
+    };
+    struct AccessMix {
+        Access measured; // thread 0
+        Access others;
+    };
+    // Cache-line contention: `threads` threads pinned to CPUs 0.. hammer own
+    // variables `distance_B` apart (0 - the same variable, 8 - the same line,
+    // 64 - adjacent lines, 4096 - separate pages). Thread 0 is measured, the
+    // throughput counts the operations of all threads.
+    void runContention(const uint32_t threads = 2,
+        const std::vector<uint32_t>& distances_B = { 0, 8, 64, 128, 4096 },
+        const std::vector<AccessMix>& mixes = {
+            { Access::Read, Access::Write },
+            { Access::Write, Access::Write },
+            { Access::Rmw, Access::Rmw } },
+        const uint32_t timePerCell_s = 1, const uint32_t minimumRepetitions = 500);
+    static const char* toString(const Access access) noexcept;
+
+    // Cache-line ping-pong between threads pinned to each pair of `cpus` (all
+    // by default). Prints round-trip and one-way (half of it) matrices and,
+    // if `csvPath` is set, exports "from,to,round_trip_ns,one_way_ns" with
+    // from < to.
+    // A round trip is symmetric, so each unordered pair is measured once:
+    // N CPUs take about N * (N - 1) / 2 * `timePerPair_ms`, e.g. 64 CPUs ~3.4 min.
+    // A pair whose threads cannot be pinned is "-" and not exported.
+    void runCoreToCore(const uint32_t timePerPair_ms = 100, const std::string& csvPath = "",
+        std::vector<uint32_t> cpus = {}, const uint32_t minimumRepetitions = 500);
+
+    enum class Interference : uint8_t {
+        MemoryHog,    // sequential copy of 4 x LLC
+        LlcThrasher,  // random lines of LLC
+        ComputeHog,   // multiplication chains on the SMT sibling
+        SyscallStorm, // getppid
+        _count,
+    };
+    // Runs the testees of run() on CPU 0 quietly and under each interference of
+    // `workers` background threads on the other cores, the SMT sibling last
+    // (first for the compute hog), started before and stopped after each
+    // measurement. Reports the slowdown versus the quiet baseline.
+    void runInterference(const uint32_t workers = 1, const uint32_t timePerTestee_s = 1,
+        const std::vector<Interference>& interferences = {
+            Interference::MemoryHog, Interference::LlcThrasher,
+            Interference::ComputeHog, Interference::SyscallStorm },
+        const uint32_t minimumRepetitions = 500);
+    static const char* toString(const Interference interference) noexcept;
+
+    // Measures each testee of run() on CPU 0 alone and beside each testee,
+    // including itself, called in a loop on another core or, if `smtSibling`,
+    // on the SMT sibling of CPU 0. Testees must be callable concurrently.
+    // Warns when the requested CPU is not available, and leaves the cells "-"
+    // when the partner could only share CPU 0.
+    void runCoRun(const bool smtSibling = false, const uint32_t timePerPair_s = 1,
+        const uint32_t minimumRepetitions = 500);
+
+    // Read-only memory-mapped file of fixed-size records, iterated zero-copy.
+    // Other platforms than Linux read it into memory.
+    class Trace {
+    public:
+        Trace(const std::string& path, const uint32_t recordSize_B);
+        ~Trace();
+        Trace(Trace&& other) noexcept;
+        Trace& operator=(Trace&& other) noexcept;
+        Trace(const Trace&) = delete;
+        Trace& operator=(const Trace&) = delete;
+        // false if the file can not be read or holds no record
+        explicit operator bool() const noexcept {
+            return m_records > 0;
+        }
+        size_t records() const noexcept {
+            return m_records;
+        }
+        uint32_t recordSize() const noexcept {
+            return m_recordSize_B;
+        }
+        // Wraps around.
+        const uint8_t* record(const size_t idx) const noexcept {
+            return m_data + (idx % m_records) * m_recordSize_B;
+        }
+        const uint8_t* next() noexcept {
+            const uint8_t* const result = m_data + m_cursor * m_recordSize_B;
+            m_cursor = m_cursor + 1 < m_records ? m_cursor + 1 : 0;
+            return result;
+        }
+    private:
+        void release() noexcept;
+        const uint8_t* m_data = nullptr;
+        size_t m_records = 0;
+        size_t m_cursor = 0;
+        uint32_t m_recordSize_B = 0;
+        size_t m_mapped_B = 0;
+        std::vector<uint8_t> m_fallback;
+    };
+    // The testee gets the next record of the trace on each call, instead of a
+    // random number. The trace must outlive the benchmark runs.
+    void addTrace(std::string name, const uint8_t column, Trace& trace,
+        std::function<uint32_t(const uint8_t* record)> testee);
+    // Open-loop replay preserving the inter-arrival timing: each record holds
+    // its arrival time as little-endian uint64 ns at `timestampOffset_B`,
+    // scaled by 1 / `speed`. Reported as by runOpenLoop(). Fails on fewer than
+    // 2 records or decreasing timestamps.
+    void runTraceReplay(const std::string& name, Trace& trace, const uint32_t timestampOffset_B,
+        std::function<uint32_t(const uint8_t* record)> testee,
+        const double speed = 1.0, const uint32_t time_s = 5);
+
+    // Fixed-width record of a batch of the main measurement in the sample log.
+    struct Sample {
+        int64_t begin_ns; // getSteadyTick_ns()
+        int64_t duration_ns;
+        uint64_t items; // reported through state() during the batch
+        uint64_t bytes;
+        uint32_t calls;
+        uint16_t cpu; // UINT16_MAX - unknown
+        uint16_t testee; // index in the order of measurement, see <path>.names
+        double counters[4]; // the first counters of state() during the batch
+        uint64_t cycles; // Linux perf events, UINT64_MAX - unavailable
+        uint64_t instructions;
+    };
+    // Linux: writes every batch of the main measurement into a preallocated
+    // memory-mapped file of `capacity` samples, the first record is the header.
+    // A line per testee goes to <path>.names: name, column and the names of its
+    // counters, tab-separated. Samples beyond the capacity are dropped. Empty
+    // path closes the log.
+    bool setSampleLog(const std::string& path, const uint64_t capacity = 1 << 24);
+    // Offline: rebuilds the tables of run() from a sample log, the counters
+    // and perf events go to the throughput.
+    static bool printSampleLog(const std::string& path);
+
+    // Writes the timeline of the following measurements to `path` as Chrome
+    // Trace Event JSON, for Perfetto or chrome://tracing: the phases of each
+    // testee, the batches of the main measurement, disturbed batches (slower
+    // than twice the fastest), CPU frequency samples (Linux cpufreq) and zones.
+    // Up to `capacity` events per testee are kept in a preallocated buffer,
+    // written after the testee, zones take up to half of it and the phases
+    // always fit. Dropped events are reported after the testee. Empty path
+    // closes the timeline.
+    bool setTimeline(const std::string& path, const uint32_t capacity = 1 << 16);
+
+    // Runs the added testee for `duration_s` in windows of `window_s`, reporting
+    // the time per call, RSS and heap fragmentation (glibc mallinfo2) of each
+    // window, and the trend of the time per call. The first window calibrates,
+    // the next ones run fixed batches for the whole window, with the watchdog
+    // and the sample log and timeline of measure().
+    void runSoak(const std::string& name, const uint8_t column,
+        const uint32_t duration_s = 600, const uint32_t window_s = 10,
+        const uint32_t minimumRepetitions = 500);
+
+    // Operations taking seconds. `setup` prepares a fresh state before each
+    // iteration and is not timed.
+    void addMacro(std::string name, std::function<void()> setup,
+        std::function<void()> operation);
+    // Runs each macro benchmark `iterations` times, in a forked child per
+    // iteration if `inChild` (Linux), and reports each iteration with its CPU
+    // time, RSS growth and I/O from /proc/self/io.
+    void runMacro(const uint32_t iterations = 5, const bool inChild = false);
+
+    struct MemoryLevelProbe {
+        uint8_t level = 0; // 0 - RAM
+        uint64_t size_B = 0;
+        int64_t latency_ps = 0;
+        double seqRead_Bps = 0.0;
+        double seqWrite_Bps = 0.0;
+        double rndRead_Bps = 0.0;
+        double rndWrite_Bps = 0.0;
+        double ntWrite_Bps = 0.0; // 0 - not supported
+    };
+    // Machine characterization: load-to-use latency by a randomized pointer chase,
+    // sequential and random read/write bandwidth and non-temporal store bandwidth
+    // for each cache level and RAM (`llcFactor` times LLC), followed by
+    // memory-level parallelism of 1..16 independent chases in RAM.
+    const std::vector<MemoryLevelProbe>& runMemoryProbe(const uint32_t timePerProbe_s = 1,
+        const uint32_t llcFactor = 4, const uint32_t minimumRepetitions = 500);
+
+    // Dynamic reporting from inside a testee, accumulated over all its calls.
+    class State {
+    public:
+        void addItems(const uint64_t items) noexcept {
+            m_items += items;
+        }
+        void addBytes(const uint64_t bytes) noexcept {
+            m_bytes += bytes;
+        }
+        // User-defined counter, e.g. hash probes. The reference stays valid
+        // during the measurement, so it can be looked up once per testee.
+        double& counter(const std::string& name);
+    private:
+        friend class Benchmark;
+        uint64_t m_items = 0;
+        uint64_t m_bytes = 0;
+        std::deque<std::pair<std::string, double>> m_counters;
+        struct ZoneStats {
+            const char* name = nullptr;
+            uint32_t parent = UINT32_MAX; // index, UINT32_MAX - top level
+            uint64_t calls = 0;
+            int64_t inclusive_ns = 0;
+            int64_t children_ns = 0;
+        };
+        std::vector<ZoneStats> m_zones;
+        std::vector<uint32_t> m_openZones;
+        uint64_t m_zonedCalls = 0; // of the main measurement, the zones count only it
+    };
+    // The state of the testee being measured by the calling thread.
+    static State& state() noexcept;
+
+    // Times the enclosing scope of a testee into the state() of the calling
+    // thread, nested zones are split out of the exclusive time. See
+    // ADAPTIVE_BENCHMARK_ZONE, the overhead is reported by run(). A zone is
+    // looked up among the zones of the testee linearly, so the overhead grows
+    // with the number of distinct zones beyond the reported one.
+    class Zone {
+    public:
+        // name: a string literal, zones are told apart by its address
+        explicit Zone(const char* name);
+        ~Zone();
+        Zone(const Zone&) = delete;
+        Zone& operator=(const Zone&) = delete;
+    private:
+        State& m_state;
+        uint32_t m_idx = 0;
+        int64_t m_begin_ns = 0;
+    };
+
+    // Log-linear histogram of values, e.g. latencies in ns, with 1/64 relative
+    // precision in 30KiB. One writer, any number of concurrent readers.
+    class Histogram {
+    public:
+        Histogram() noexcept;
+        Histogram(const Histogram&) = delete;
+        Histogram& operator=(const Histogram&) = delete;
+        void record(const uint64_t value, const uint64_t count = 1) noexcept;
+        // Coordinated-omission correction for a closed loop expecting a value per
+        // `expectedInterval`: also records the calls that would have been issued
+        // during the stall, `value - expectedInterval`, ... down to the interval.
+        void recordCorrected(const uint64_t value, const uint64_t expectedInterval) noexcept;
+        void merge(const Histogram& other) noexcept;
+        // Removes the counts of `older`, an earlier copy of this histogram.
+        void subtract(const Histogram& older) noexcept;
+        // Not concurrently with record().
+        void reset() noexcept;
+        uint64_t count() const noexcept;
+        uint64_t min() const noexcept; // UINT64_MAX if empty
+        uint64_t max() const noexcept;
+        // The highest value equivalent to the percentile 0..100, 0 if empty.
+        uint64_t percentile(const double percentile) const noexcept;
+    private:
+        static constexpr uint32_t subBucketBits = 6;
+        static constexpr uint32_t subBuckets = 1 << subBucketBits;
+        static constexpr uint32_t buckets = (64 - subBucketBits + 1) * subBuckets;
+        static uint32_t toIndex(const uint64_t value) noexcept;
+        static uint64_t toHighestValue(const uint32_t index) noexcept;
+        static void add(std::atomic<uint64_t>& counter, const uint64_t value) noexcept {
+            // Single writer, no locked instruction.
+            counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+        }
+        std::atomic<uint64_t> m_counts[buckets];
+        std::atomic<uint64_t> m_count;
+        std::atomic<uint64_t> m_min;
+        std::atomic<uint64_t> m_max;
+    };
+
+    // Records durations from any number of threads into thread-local
+    // histograms, without locks after the first record of a thread. A collector
+    // thread merges them every period into a snapshot of that interval. The
+    // histogram of an exited thread is folded into the recorder and reused.
+    class LatencyRecorder {
+    public:
+        struct Snapshot {
+            int64_t interval_ns = 0;
+            uint64_t count = 0;
+            uint64_t p50_ns = 0;
+            uint64_t p90_ns = 0;
+            uint64_t p99_ns = 0;
+            uint64_t p999_ns = 0;
+            uint64_t max_ns = 0;
+            // e.g. 1.23 M/s, p50 21ns, p90 ...
+            std::string toString() const;
+        };
+        // `onSnapshot` is called from the collector thread, 0 - no collector.
+        explicit LatencyRecorder(const uint32_t period_ms = 1000,
+            std::function<void(const Snapshot&)> onSnapshot = nullptr);
+        ~LatencyRecorder();
+        LatencyRecorder(const LatencyRecorder&) = delete;
+        LatencyRecorder& operator=(const LatencyRecorder&) = delete;
+        void record(const uint64_t duration_ns) noexcept;
+        // Records the lifetime of the scope.
+        class Scope {
+        public:
+            explicit Scope(LatencyRecorder& recorder) noexcept
+                : m_recorder(recorder), m_begin_ns(getSteadyTick_ns()) {
+            }
+            ~Scope() {
+                m_recorder.record(static_cast<uint64_t>(getSteadyTick_ns() - m_begin_ns));
+            }
+            Scope(const Scope&) = delete;
+            Scope& operator=(const Scope&) = delete;
+        private:
+            LatencyRecorder& m_recorder;
+            const int64_t m_begin_ns;
+        };
+        // Merges the threads into the snapshot of the interval since the previous
+        // collection, also done by the collector thread.
+        Snapshot collect();
+        // The last collected snapshot.
+        Snapshot snapshot() const;
+    private:
+        // The recorders alive, for the threads exiting after some of them.
+        struct Registry {
+            std::mutex mutex;
+            std::vector<LatencyRecorder*> recorders;
+        };
+        static Registry& registry();
+        Histogram& threadHistogram();
+        // Folds the histogram of an exited thread into m_retired and recycles it.
+        void release(Histogram& histogram);
+        const uint64_t m_id;
+        mutable std::mutex m_mutex;
+        std::deque<Histogram> m_threads;
+        std::vector<Histogram*> m_free; // of the exited threads, reset
+        Histogram m_retired;
+        Histogram m_total; // merged at the previous collection
+        Histogram m_interval;
+        int64_t m_collected_ns = 0;
+        Snapshot m_snapshot;
+        std::condition_variable m_wakeup;
+        bool m_stop = false;
+        std::thread m_collector;
+    };
+
+    // Open loop: calls the testees of run() at each rate of `rates_Hz` from a
+    // fixed schedule and takes the latency from the intended start, so queueing
+    // behind late calls is included, as well as the calls never issued.
+    // Empty `rates_Hz` sweeps 10%..150% of the capacity of the same loop with
+    // the calls back to back, including its timing and recording, and stops
+    // after saturation, then adds a closed loop at 50% with the coordinated
+    // omission corrected by Histogram::recordCorrected().
+    void runOpenLoop(std::vector<double> rates_Hz = {}, const uint32_t timePerRate_s = 1,
+        const uint32_t minimumRepetitions = 500);
+
+    // Declares the items and bytes processed by one call, for the throughput
+    // section of run(). Added to the ones reported through state().
+    void setProcessed(const std::string& name, const uint8_t column,
+        const double itemsPerCall, const double bytesPerCall);
+
     static int64_t getSteadyTickStd_ns() noexcept;
     static int64_t getSteadyTick_ns() noexcept;
 
@@ -40,8 +616,13 @@ public:
     // Output: 3..11 symbols
     //   d h m s ms us ns ps
     static std::string makeDurationString(const int64_t duration_ps);
+    // Output: 1KiB, 1.5MiB, ...
+    static std::string makeSizeString(const uint64_t size_B);
+    // Output: 1.23 G<unit>/s, ...
+    static std::string makeRateString(const double perSecond, const char* unit);
 
     Benchmark();
+    ~Benchmark();
 
     class lcg32 {
     public:
@@ -62,16 +643,88 @@ public:
         uint32_t m_x = 1;
     };
 
+    // Constant memory statistics of a stream of values.
+    class StreamingStatistics {
+    public:
+        explicit StreamingStatistics(const uint32_t reservoirSize = 65536,
+            std::vector<double> sketchedQuantiles = { 0.5, 0.9, 0.99 });
+        void add(const double value) noexcept;
+        void reset() noexcept;
+        uint64_t count() const noexcept {
+            return m_count;
+        }
+        double mean() const noexcept {
+            return m_mean;
+        }
+        double variance() const noexcept {
+            return m_count > 1 ? m_m2 / (m_count - 1) : 0.0;
+        }
+        // Of the reservoir, `quantile` 0..1.
+        double quantile(const double quantile) const;
+        // P² estimate of the sketched quantile with the index.
+        double sketch(const size_t idx) const noexcept;
+        // Percentile bootstrap of the quantile over the reservoir.
+        std::pair<double, double> bootstrapCi95(const double quantile,
+            const uint32_t resamples = 200) const;
+    private:
+        // Jain & Chlamtac, five markers per quantile.
+        struct P2 {
+            double quantile = 0.5;
+            double heights[5] = {};
+            double positions[5] = {};
+            double desired[5] = {};
+            void add(const double value, const uint64_t count) noexcept;
+        };
+        uint64_t m_count = 0;
+        double m_mean = 0.0;
+        double m_m2 = 0.0;
+        std::vector<float> m_reservoir;
+        uint32_t m_reservoirSize = 0;
+        std::vector<P2> m_sketches;
+        lcg32 m_rng;
+    };
+
 private:
     static std::string toString(const uint64_t value, const uint8_t width);
+    // align: 'l' or 'r' for each column
+    static void printTable(const std::vector<std::string>& header,
+        const std::vector<std::vector<std::string>>& rows, const std::string& align);
 
     struct TesteeMeta {
         std::function<uint32_t(uint32_t random)> function;
         int64_t minimum_ps = 0;
         int64_t average_ps = 0;
         int64_t maximum_ps = 0;
+        double opsPerCall = 0.0;
+        double bytesPerCall = 0.0;
+        bool integerOps = false;
+        double itemsPerCall = 0.0;
+        double processedBytesPerCall = 0.0;
+        uint64_t calls = 0;
+        State state;
+        // Estimator::Regression
+        double slope_ps = 0.0;
+        double slopeCi95_ps = 0.0;
+        double intercept_ps = 0.0;
+        double r2 = 0.0;
+        // Cut short by the watchdog, or the main measurement made fewer calls
+        // than the minimum repetitions.
+        bool partial = false;
+        uint64_t timelineDropped = 0; // over the capacity of setTimeline()
+        bool probe = false; // of the harness, kept out of the sample log and timeline
+        // Called right before and after the main measurement, outside its batches.
+        std::function<void()> mainBegins;
+        std::function<void()> mainEnds;
+        // setStreamingStatistics()
+        double stddev_ps = 0.0;
+        double sketches_ps[3] = {}; // p50, p90, p99
+        double median_ps = 0.0;
+        std::pair<double, double> medianCi95_ps;
     };
     std::vector<std::pair<std::string, std::vector<TesteeMeta>>> m_testees;
+    TesteeMeta* findTestee(const std::string& name, const uint8_t column);
+    // Row of the testees with the name, created with empty cells if absent.
+    std::vector<TesteeMeta>& getRow(std::string name);
     struct ColumnMeta {
         int64_t minTime_ps = INT64_MAX;
         int64_t maxTime_ps = INT64_MAX;
@@ -79,10 +732,280 @@ private:
         uint32_t minTimeStrLength = sizeof("Time") - 1;
         uint32_t maxTimeStrLength = sizeof("Time") - 1;
         uint32_t avgTimeStrLength = sizeof("Time") - 1;
+        std::string name = "Time";
     };
     std::vector<ColumnMeta> m_columns;
     uint32_t m_maxNameLength = sizeof("Name") - 1;
 
+    struct WorkingSetMeta {
+        std::string name;
+        std::function<void(size_t size_B)> setup;
+        TesteeMeta testee;
+        uint32_t bytesPerCall = 0;
+    };
+    std::vector<WorkingSetMeta> m_workingSets;
+
+    struct PlacementMeta {
+        std::string name;
+        size_t size_B = 0;
+        std::function<void(uint8_t* data, size_t size_B)> setup;
+        TesteeMeta testee;
+    };
+    std::vector<PlacementMeta> m_placements;
+
+    struct OffsetSweepMeta {
+        std::string name;
+        size_t size_B = 0;
+        Misalign misalign = Misalign::Both;
+        std::function<uint32_t(uint32_t random, const uint8_t* input, uint8_t* output)> function;
+    };
+    std::vector<OffsetSweepMeta> m_offsetSweeps;
+
+    struct BranchPatternsMeta {
+        std::string name;
+        uint32_t count = 0;
+        std::function<uint32_t(uint32_t random, const uint8_t* taken, uint32_t count)> function;
+    };
+    std::vector<BranchPatternsMeta> m_branchPatterns;
+
+    // Hardware event of the calling thread, not counting if unavailable.
+    class PerfCounter {
+    public:
+        PerfCounter(const uint32_t type, const uint64_t config) noexcept;
+        ~PerfCounter();
+        PerfCounter(const PerfCounter&) = delete;
+        PerfCounter& operator=(const PerfCounter&) = delete;
+        explicit operator bool() const noexcept {
+            return m_fd >= 0;
+        }
+        void start() noexcept;
+        uint64_t stop() noexcept;
+        // Since start(), without stopping.
+        uint64_t read() const noexcept;
+    private:
+        int m_fd = -1;
+    };
+
+    // false if not supported
+    static bool pinThread(const uint32_t cpu) noexcept;
+    // Linux: /sys/devices/system/cpu/cpuN/topology/thread_siblings_list
+    static std::vector<uint32_t> getSmtSiblings(const uint32_t cpu);
+    static void interfere(const Interference interference, uint8_t* data,
+        const size_t size_B, const std::atomic<bool>& stop);
+    static constexpr uint32_t contentionOpsPerCall = 64;
+    static constexpr uint32_t pingPongsPerCall = 16;
+    template <Access A>
+    ADAPTIVE_BENCHMARK_FORCEINLINE static uint64_t access(
+        std::atomic<uint64_t>& variable, const uint64_t value) noexcept;
+    static uint64_t accessMany(const Access access,
+        std::atomic<uint64_t>& variable, const uint64_t value) noexcept;
+
+    // Calls `function` at the begin plus `schedule_ns(call)` until `time_ns`
+    // passes, records the latencies from the intended starts including the calls
+    // never issued. Returns the completed calls per second. Empty `schedule_ns`
+    // issues the calls back to back, for the capacity of the same loop.
+    double runSchedule(const std::function<uint32_t(uint32_t random)>& function,
+        const std::function<int64_t(uint64_t call)>& schedule_ns, const int64_t time_ns,
+        Histogram& histogram);
+    // Closed loop: calls `function` one after another, each due `interval_ns`
+    // after the previous one but not before it completes, until `time_ns` passes.
+    // Records the service times corrected for the calls a stall held back.
+    // Returns the completed calls per second.
+    double runClosedLoop(const std::function<uint32_t(uint32_t random)>& function,
+        const int64_t interval_ns, const int64_t time_ns, Histogram& histogram);
+    // Sleeps until shortly before `tick_ns`, then spins to it. Returns the tick.
+    static int64_t waitUntil(const int64_t tick_ns) noexcept;
+    // Offered, Achieved, p50, p90, p99, p99.9, Max
+    static std::vector<std::string> makeLatencyRow(const double offered_Hz,
+        const double achieved_Hz, const Histogram& histogram);
+
+    // Averages of all testee cells, 0 - Noop.
+    std::vector<int64_t> measureLayout(const size_t stackOffset_B, const size_t heapOffset_B,
+        const int64_t timePerLayout_ns, const uint32_t minimumRepetitions,
+        const std::function<void(size_t heapOffset_B)>& relocate);
+#ifdef __linux__
+    std::vector<int64_t> measureLayoutInChild(const size_t stackOffset_B,
+        const size_t heapOffset_B, const size_t environmentPadding_B);
+#endif // __linux__
+
+    struct MacroMeta {
+        std::string name;
+        std::function<void()> setup;
+        std::function<void()> operation;
+    };
+    std::vector<MacroMeta> m_macros;
+    struct MacroIteration {
+        int64_t time_ns = 0;
+        int64_t user_ns = 0;
+        int64_t system_ns = 0;
+        int64_t rss_B = 0; // growth
+        uint64_t peakRss_B = 0; // high-water mark during the operation
+        uint64_t read_B = 0; // from the storage
+        uint64_t written_B = 0;
+        bool ok = false;
+    };
+    static MacroIteration runMacroIteration(const MacroMeta& macro);
+
+    struct InstructionMeta {
+        std::string name;
+        // chain of 256, chain of 512, streams of 256, streams of 512
+        std::function<uint32_t(uint32_t random)> kernels[4];
+    };
+    std::vector<InstructionMeta> m_instructions;
+    // f(0), f(1), ..., f(N - 1)
+    template <uint32_t N>
+    struct Unroll {
+        template <typename F>
+        ADAPTIVE_BENCHMARK_FORCEINLINE static void run(F& f) {
+            Unroll<N - 1>::run(f);
+            f(N - 1);
+        }
+    };
+    // Hides the value from the optimizer without emitting an instruction.
+    template <typename T>
+    ADAPTIVE_BENCHMARK_FORCEINLINE static void keepInRegister(T& value) noexcept;
+    // Lambdas can not be force-inlined, and constant indices of fully inlined
+    // steps let the streams live in registers.
+    static constexpr uint32_t instructionStreams = 8;
+    template <typename T, typename Op, uint32_t Streams>
+    struct InstructionStep {
+        const Op& op;
+        T* a;
+        const T& b;
+        ADAPTIVE_BENCHMARK_FORCEINLINE void operator()(const uint32_t k) const {
+            a[k % Streams] = op(a[k % Streams], b);
+            keepInRegister(a[k % Streams]);
+        }
+    };
+    template <typename T, typename Op>
+    struct InstructionStreamsStep {
+        const InstructionStep<T, Op, instructionStreams>& stream;
+        ADAPTIVE_BENCHMARK_FORCEINLINE void operator()(const uint32_t) const {
+            Unroll<instructionStreams>::run(stream);
+        }
+    };
+    template <uint32_t Ops, typename T, typename Op>
+    static std::function<uint32_t(uint32_t random)> makeChainKernel(
+        const Op& op, const T x, const T y);
+    template <uint32_t Ops, typename T, typename Op>
+    static std::function<uint32_t(uint32_t random)> makeStreamsKernel(
+        const Op& op, const T x, const T y);
+    std::vector<MemoryLevelProbe> m_memoryProbe;
+
+    // Peaks of this build on the current host, 0 - not measured yet.
+    double m_peakFlops = 0.0;
+    double m_peakIntOps = 0.0;
+    double m_peakBandwidth_Bps = 0.0;
+    void measureRooflinePeaks(const int64_t timePerProbe_ns, const uint32_t minimumRepetitions);
+    void printRoofline();
+    void printThroughput();
+
+    static thread_local State* s_state;
+
+    void measure(TesteeMeta& testee, const int64_t testeeBegin_ns,
+        const int64_t timePerTestee_ns, const uint32_t minimumRepetitions);
+    void measureRegression(TesteeMeta& testee, const int64_t lastTick_ns, const uint32_t n);
+    // Batches of n calls for timePerTestee_ns, without calibration.
+    void measureBatches(TesteeMeta& testee, const int64_t testeeBegin_ns,
+        const int64_t timePerTestee_ns, const uint32_t n, const uint32_t minimumRepetitions);
+    void printRegression();
+    std::unique_ptr<StreamingStatistics> m_streaming;
+    void printStreamingStatistics();
+    // The minimum, maximum and average tables of run().
+    void addToColumn(const size_t columnIdx, const TesteeMeta& testee);
+    void printTimes();
+    // Per zone, 0 - no zones were recorded.
+    int64_t measureZoneOverhead(const int64_t timePerTestee_ns,
+        const uint32_t minimumRepetitions);
+    void printZones(const int64_t overhead_ps);
+    // Two-sided 95% quantile of Student's t-distribution.
+    static double studentT95(const uint64_t degreesOfFreedom);
+    Estimator m_estimator = Estimator::Batch;
+    lcg32 m_rng;
+    uint32_t m_doNotOptimize = 0;
+
+    struct SampleLogHeader {
+        uint64_t magic; // "ABSMPL02"
+        uint64_t sampleSize_B;
+        uint64_t samples;
+        uint64_t capacity;
+        uint64_t reserved[7];
+    };
+    static constexpr uint64_t sampleLogMagic = UINT64_C(0x32304C504D534241);
+    struct SampleLog {
+        SampleLogHeader* header = nullptr; // samples follow
+        std::ofstream names;
+        uint16_t testee = 0;
+        uint64_t items = 0; // of the testee at the end of the previous batch
+        uint64_t bytes = 0;
+        double counters[4] = {};
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        // Opened by the measuring thread for the main measurement.
+        std::unique_ptr<PerfCounter> cyclesCounter;
+        std::unique_ptr<PerfCounter> instructionsCounter;
+        int fd = -1;
+    } m_sampleLog;
+    void startSampleLog(const TesteeMeta& testee);
+    void finishSampleLog(const TesteeMeta& testee);
+    void closeSampleLog() noexcept;
+    void logSample(const TesteeMeta& testee, const int64_t begin_ns, const int64_t end_ns,
+        const uint32_t calls) noexcept;
+    std::string m_measuredName; // of the next measured testee, set by run()
+
+    struct TimelineEvent {
+        const char* name; // a literal
+        char phase; // X - complete, C - counter
+        int64_t begin_ns;
+        int64_t duration_ns;
+        uint64_t value; // calls of a batch, kHz of a frequency sample
+    };
+    struct Timeline {
+        std::ofstream file;
+        std::vector<TimelineEvent> events;
+        size_t capacity = 0;
+        uint64_t dropped = 0; // of the testee
+        uint64_t totalDropped = 0;
+        int64_t origin_ns = 0;
+        int64_t nextFrequency_ns = 0;
+        int frequencyFd = -1; // cpufreq of frequencyCpu, kept open between the samples
+        int frequencyCpu = -1;
+        uint32_t testee = 0; // thread id of the track
+        bool empty = true;
+        // The last slots are kept for the rough, clarifying and main phases.
+        static constexpr size_t phaseSlots = 4;
+        void add(const char* name, const char phase, const int64_t begin_ns,
+                const int64_t end_ns, const uint64_t value = 0) noexcept {
+            push({ name, phase, begin_ns, end_ns - begin_ns, value }, capacity - phaseSlots);
+        }
+        void addPhase(const char* name, const int64_t begin_ns, const int64_t end_ns,
+                const uint64_t calls) noexcept {
+            push({ name, 'X', begin_ns, end_ns - begin_ns, calls }, capacity);
+        }
+        // Zones take up to half of the buffer, the rest is left to the batches.
+        void addZone(const char* name, const int64_t begin_ns, const int64_t end_ns) noexcept {
+            push({ name, 'X', begin_ns, end_ns - begin_ns, 0 }, capacity / 2);
+        }
+        void push(const TimelineEvent& event, const size_t limit) noexcept {
+            if (events.size() < limit) {
+                events.push_back(event);
+            }
+            else {
+                ++dropped;
+            }
+        }
+    } m_timeline;
+    // The timeline of the measuring thread, for zones.
+    static thread_local Timeline* s_timeline;
+    void closeTimeline();
+    void addTimelineBatch(const TesteeMeta& testee, const int64_t begin_ns,
+        const int64_t end_ns, const uint32_t calls) noexcept;
+    void sampleTimelineFrequency() noexcept;
+    // Returns the number of dropped events of the testee.
+    uint64_t flushTimeline();
+    // Of the CPU running the calling thread, 0 - unknown.
+    uint64_t getCpuFrequency_kHz() noexcept;
+
 # ifdef _WIN32
 #  ifdef _M_ARM64
     static uint64_t s_Hz;
@@ -92,6 +1015,114 @@ private:
 # endif // _WIN32
 };
 
+// Registers a kernel given by its body, the body of a uint32_t(uint32_t random)
+// function, compiled for each Benchmark::Isa by the target attribute. The body
+// itself gets the target, so it needs no inlining, but the Generic variant
+// compiles it too: intrinsics beyond the baseline ISA go to addIsaVariant().
+#if (defined(__GNUC__) || defined(__clang__)) && defined(ADAPTIVE_BENCHMARK_X86)
+# define ADAPTIVE_BENCHMARK_ADD_ISA_VARIANTS(benchmark, name, ...) \
+    do { \
+        struct IsaVariants { \
+            static uint32_t generic(uint32_t random) __VA_ARGS__ \
+            __attribute__((target("sse4.2,popcnt"))) \
+            static uint32_t sse42(uint32_t random) __VA_ARGS__ \
+            __attribute__((target("avx2,fma,bmi,bmi2"))) \
+            static uint32_t avx2(uint32_t random) __VA_ARGS__ \
+            __attribute__((target("avx512f,avx512bw,avx512dq,avx512vl,avx2,fma,bmi,bmi2"))) \
+            static uint32_t avx512(uint32_t random) __VA_ARGS__ \
+        }; \
+        (benchmark).addIsaVariant((name), Benchmark::Isa::Generic, &IsaVariants::generic); \
+        (benchmark).addIsaVariant((name), Benchmark::Isa::SSE42, &IsaVariants::sse42); \
+        (benchmark).addIsaVariant((name), Benchmark::Isa::AVX2, &IsaVariants::avx2); \
+        (benchmark).addIsaVariant((name), Benchmark::Isa::AVX512, &IsaVariants::avx512); \
+    } while (false)
+#else
+// MSVC has no per-function targets.
+# define ADAPTIVE_BENCHMARK_ADD_ISA_VARIANTS(benchmark, name, ...) \
+    (benchmark).addIsaVariant((name), Benchmark::Isa::Generic, \
+        [](uint32_t random) -> uint32_t __VA_ARGS__)
+#endif
+
+// Times the rest of the scope as the zone `name`, a string literal.
+#define ADAPTIVE_BENCHMARK_ZONE_CONCAT2(a, b) a##b
+#define ADAPTIVE_BENCHMARK_ZONE_CONCAT(a, b) ADAPTIVE_BENCHMARK_ZONE_CONCAT2(a, b)
+#define ADAPTIVE_BENCHMARK_ZONE(name) \
+    Benchmark::Zone ADAPTIVE_BENCHMARK_ZONE_CONCAT(adaptiveBenchmarkZone, __LINE__)(name)
+#ifndef BENCH_ZONE
+# define BENCH_ZONE(name) ADAPTIVE_BENCHMARK_ZONE(name)
+#endif
+
+template <>
+struct Benchmark::Unroll<0> {
+    template <typename F>
+    ADAPTIVE_BENCHMARK_FORCEINLINE static void run(F&) {}
+};
+
+template <typename T>
+ADAPTIVE_BENCHMARK_FORCEINLINE void Benchmark::keepInRegister(T& value) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    // General purpose or vector register, whichever the value is in.
+    asm volatile("" : "+r,x"(value));
+#else
+    // MSVC has no inline assembly on x64, chains of trivial operations
+    // may be folded by the optimizer.
+    (void)value;
+#endif
+}
+
+template <uint32_t Ops, typename T, typename Op>
+std::function<uint32_t(uint32_t random)> Benchmark::makeChainKernel(
+        const Op& op, const T x, const T y) {
+    return [op, x, y](uint32_t) -> uint32_t {
+        T a[1] = { x };
+        T b = y;
+        keepInRegister(a[0]);
+        keepInRegister(b);
+        InstructionStep<T, Op, 1> step = { op, a, b };
+        Unroll<Ops>::run(step);
+        uint32_t result = 0;
+        std::memcpy(&result, &a[0], std::min(sizeof(T), sizeof(result)));
+        return result;
+    };
+}
+
+template <uint32_t Ops, typename T, typename Op>
+std::function<uint32_t(uint32_t random)> Benchmark::makeStreamsKernel(
+        const Op& op, const T x, const T y) {
+    return [op, x, y](uint32_t) -> uint32_t {
+        // Each stream is hidden separately, otherwise they are merged.
+        T a[instructionStreams];
+        for (uint32_t k = 0; k < instructionStreams; ++k) {
+            a[k] = x;
+            keepInRegister(a[k]);
+        }
+        T b = y;
+        keepInRegister(b);
+        InstructionStep<T, Op, instructionStreams> stream = { op, a, b };
+        InstructionStreamsStep<T, Op> step = { stream };
+        Unroll<Ops / instructionStreams>::run(step);
+        uint32_t result = 0;
+        for (uint32_t k = 0; k < instructionStreams; ++k) {
+            uint32_t bits = 0;
+            std::memcpy(&bits, &a[k], std::min(sizeof(T), sizeof(bits)));
+            result ^= bits;
+        }
+        return result;
+    };
+}
+
+template <typename T, typename Op>
+void Benchmark::addInstruction(std::string name, Op op, const T x, const T y) {
+    assert(!name.empty());
+    m_instructions.emplace_back();
+    auto& meta = m_instructions.back();
+    meta.name = std::move(name);
+    meta.kernels[0] = makeChainKernel<256>(op, x, y);
+    meta.kernels[1] = makeChainKernel<512>(op, x, y);
+    meta.kernels[2] = makeStreamsKernel<256>(op, x, y);
+    meta.kernels[3] = makeStreamsKernel<512>(op, x, y);
+}
+
 
 
 #ifdef _WIN32
@@ -119,11 +1150,27 @@ void Benchmark::setColumnsNumber(const uint8_t number) {
     m_columns.resize(number);
 }
 
+void Benchmark::setColumnName(const uint8_t column, std::string name) {
+    assert(column < m_columns.size());
+    assert(!name.empty());
+    auto& meta = m_columns.at(column);
+    const uint32_t length = static_cast<uint32_t>(name.size());
+    meta.minTimeStrLength = std::max(meta.minTimeStrLength, length);
+    meta.maxTimeStrLength = std::max(meta.maxTimeStrLength, length);
+    meta.avgTimeStrLength = std::max(meta.avgTimeStrLength, length);
+    meta.name = std::move(name);
+}
+
 void Benchmark::add(std::string name, const uint8_t column,
         std::function<uint32_t(uint32_t random)> testee) {
     assert(!name.empty());
     assert(column < m_columns.size());
     assert(testee);
+    auto& meta = getRow(std::move(name)).at(column);
+    meta.function  = std::move(testee);
+}
+
+std::vector<Benchmark::TesteeMeta>& Benchmark::getRow(std::string name) {
     m_maxNameLength = std::max(static_cast<uint32_t>(name.size()), m_maxNameLength);
 
     std::vector<TesteeMeta>* vec = nullptr;
@@ -133,297 +1180,4319 @@ void Benchmark::add(std::string name, const uint8_t column,
             break;
         }
     }
-    if (vec == nullptr) {
-        m_testees.emplace_back();
-        m_testees.back().first = std::move(name);
-        vec = &m_testees.back().second;
+    if (vec == nullptr) {
+        m_testees.emplace_back();
+        m_testees.back().first = std::move(name);
+        vec = &m_testees.back().second;
+    }
+    vec->resize(m_columns.size());
+    return *vec;
+}
+
+void Benchmark::addWorkingSet(std::string name, std::function<void(size_t size_B)> setup,
+        std::function<uint32_t(uint32_t random)> testee, const uint32_t bytesPerCall) {
+    assert(!name.empty());
+    assert(setup);
+    assert(testee);
+    m_workingSets.emplace_back();
+    auto& meta = m_workingSets.back();
+    meta.name = std::move(name);
+    meta.setup = std::move(setup);
+    meta.testee.function = std::move(testee);
+    meta.bytesPerCall = bytesPerCall;
+}
+
+void Benchmark::addIsaVariant(const std::string& name, const Isa isa,
+        std::function<uint32_t(uint32_t random)> testee) {
+    const uint8_t column = static_cast<uint8_t>(isa);
+    if (m_columns.size() < static_cast<size_t>(Isa::_count)) {
+        setColumnsNumber(static_cast<uint8_t>(Isa::_count));
+        // The rows added before get the empty cells too.
+        for (auto& itVec : m_testees) {
+            itVec.second.resize(m_columns.size());
+        }
+    }
+    if (m_columns[column].name == "Time") {
+        setColumnName(column, toString(isa));
+    }
+    if (!isSupported(isa)) {
+        // The row gets an empty cell.
+        getRow(name);
+        return;
+    }
+    add(name, column, std::move(testee));
+}
+
+void Benchmark::setWork(const std::string& name, const uint8_t column,
+        const double opsPerCall, const double bytesPerCall, const bool integerOps) {
+    assert(opsPerCall >= 0.0);
+    assert(bytesPerCall >= 0.0);
+    TesteeMeta* const testee = findTestee(name, column);
+    assert(testee != nullptr);
+    if (testee == nullptr) {
+        return;
+    }
+    testee->opsPerCall = opsPerCall;
+    testee->bytesPerCall = bytesPerCall;
+    testee->integerOps = integerOps;
+}
+
+void Benchmark::setProcessed(const std::string& name, const uint8_t column,
+        const double itemsPerCall, const double bytesPerCall) {
+    assert(itemsPerCall >= 0.0);
+    assert(bytesPerCall >= 0.0);
+    TesteeMeta* const testee = findTestee(name, column);
+    assert(testee != nullptr);
+    if (testee == nullptr) {
+        return;
+    }
+    testee->itemsPerCall = itemsPerCall;
+    testee->processedBytesPerCall = bytesPerCall;
+}
+
+Benchmark::TesteeMeta* Benchmark::findTestee(const std::string& name, const uint8_t column) {
+    for (auto& it : m_testees) {
+        if (it.first == name) {
+            return column < it.second.size() ? &it.second[column] : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+void Benchmark::runSoak(const std::string& name, const uint8_t column,
+        const uint32_t duration_s, const uint32_t window_s, const uint32_t minimumRepetitions) {
+    assert(window_s > 0);
+    assert(duration_s >= window_s);
+    assert(minimumRepetitions >= 10);
+    TesteeMeta* const testee = findTestee(name, column);
+    assert(testee && testee->function);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t window_ns = static_cast<int64_t>(window_s) * 1000000000;
+    const uint32_t windows = duration_s / window_s;
+    std::cout << "Soak is running for " << windows << " windows of " << name << ":\n";
+
+    std::vector<std::vector<std::string>> rows;
+    std::vector<double> averages_ps;
+    // The first window calibrates the batch, the next ones run main batches only.
+    uint32_t n = 1;
+    for (uint32_t windowIdx = 0; windowIdx < windows; ++windowIdx) {
+        std::cout << " [" << windowIdx << "] " << name << "... ";
+        std::cout.flush();
+        // From now, an overrun of the previous window does not shorten this one.
+        const int64_t windowBegin_ns = getSteadyTickStd_ns();
+        m_measuredName = name + " [" + std::to_string(windowIdx) + "]\t"
+            + m_columns[column].name;
+        if (windowIdx == 0) {
+            measure(*testee, windowBegin_ns, window_ns, minimumRepetitions);
+            // 5 ms, as the batches of the main measurement.
+            n = static_cast<uint32_t>(std::max<int64_t>(
+                INT64_C(5000000000) / std::max<int64_t>(testee->average_ps, 1), 1));
+        }
+        else {
+            measureBatches(*testee, windowBegin_ns, window_ns, n, minimumRepetitions);
+            // A testee slowing down gets smaller batches in the next windows.
+            if (testee->partial && testee->average_ps > 0) {
+                n = static_cast<uint32_t>(std::max<int64_t>(std::min<int64_t>(
+                    INT64_C(5000000000) / testee->average_ps, n), 1));
+            }
+        }
+        m_measuredName.clear();
+        averages_ps.push_back(static_cast<double>(testee->average_ps));
+
+        uint64_t rss_B = 0;
+        uint64_t heapUsed_B = 0;
+        uint64_t heapFree_B = 0;
+#ifdef __linux__
+        uint64_t pages = 0;
+        std::ifstream("/proc/self/statm") >> pages >> pages;
+        rss_B = pages * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+# if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+        const struct mallinfo2 info = mallinfo2();
+        heapUsed_B = info.uordblks + info.hblkhd;
+        heapFree_B = info.fordblks;
+# endif
+#endif // __linux__
+        std::ostringstream change;
+        if (averages_ps.front() > 0.0) {
+            change << std::fixed << std::setprecision(1)
+                << 100.0 * (averages_ps.back() - averages_ps.front()) / averages_ps.front();
+        }
+        else {
+            change << "-";
+        }
+        std::ostringstream fragmentation;
+        fragmentation << std::fixed << std::setprecision(1)
+            << (heapUsed_B + heapFree_B > 0
+                ? 100.0 * heapFree_B / (heapUsed_B + heapFree_B) : 0.0);
+        rows.push_back({
+            std::to_string(windowIdx),
+            makeDurationString((getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000),
+            makeDurationString(testee->average_ps),
+            change.str(),
+            makeSizeString(rss_B),
+            makeSizeString(heapUsed_B),
+            fragmentation.str(),
+        });
+
+        std::cout << "Done in " << makeDurationString(
+                (getSteadyTickStd_ns() - windowBegin_ns) * 1000)
+            << (m_doNotOptimize ? " " : "  ");
+        if (testee->partial) {
+            std::cout << "Partial, " << testee->calls << " calls in the window. ";
+        }
+        if (testee->timelineDropped > 0) {
+            std::cout << "Timeline dropped " << testee->timelineDropped << " events.";
+        }
+        std::cout << std::endl;
+    }
+
+    std::cout << "\nSoak of " << name << " by window of " << window_s << "s:\n";
+    printTable({ "Window", "Elapsed", "Time", "Change %", "RSS", "Heap used",
+        "Heap free %" }, rows, "rrrrrrr");
+
+    // Least squares of the window averages over the window index.
+    if (averages_ps.size() >= 3) {
+        const double count = static_cast<double>(averages_ps.size());
+        double meanX = (count - 1.0) / 2.0;
+        double meanY = 0.0;
+        for (const double average_ps : averages_ps) {
+            meanY += average_ps / count;
+        }
+        double m2X = 0.0;
+        double cXY = 0.0;
+        double m2Y = 0.0;
+        for (size_t idx = 0; idx < averages_ps.size(); ++idx) {
+            m2X += (idx - meanX) * (idx - meanX);
+            cXY += (idx - meanX) * (averages_ps[idx] - meanY);
+            m2Y += (averages_ps[idx] - meanY) * (averages_ps[idx] - meanY);
+        }
+        const double slope_ps = cXY / m2X;
+        const double residual = std::max(m2Y - slope_ps * cXY, 0.0);
+        const double ci95_ps = studentT95(averages_ps.size() - 2)
+            * std::sqrt(residual / (count - 2.0) / m2X);
+        std::ostringstream trend;
+        trend << std::showpos << std::fixed << std::setprecision(2)
+            << 100.0 * slope_ps / meanY << std::noshowpos << "% per window, CI95 "
+            << 100.0 * ci95_ps / meanY << "%, "
+            << (slope_ps - ci95_ps > 0.0 ? "degrading"
+                : slope_ps + ci95_ps < 0.0 ? "improving" : "stable");
+        std::cout << "\nTrend: " << trend.str() << "\n";
+    }
+    std::cout << "\nSoak finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+void Benchmark::addMacro(std::string name, std::function<void()> setup,
+        std::function<void()> operation) {
+    assert(!name.empty());
+    assert(operation);
+    m_macros.emplace_back();
+    auto& meta = m_macros.back();
+    meta.name = std::move(name);
+    meta.setup = std::move(setup);
+    meta.operation = std::move(operation);
+}
+
+Benchmark::MacroIteration Benchmark::runMacroIteration(const MacroMeta& macro) {
+    // rss_B, user_ns, system_ns, read_B, written_B
+    const auto sample = [](MacroIteration& usage) {
+#ifdef __linux__
+        uint64_t pages = 0;
+        std::ifstream("/proc/self/statm") >> pages >> pages;
+        usage.rss_B = static_cast<int64_t>(pages * sysconf(_SC_PAGESIZE));
+        rusage self;
+        getrusage(RUSAGE_SELF, &self);
+        usage.user_ns = self.ru_utime.tv_sec * INT64_C(1000000000)
+            + self.ru_utime.tv_usec * INT64_C(1000);
+        usage.system_ns = self.ru_stime.tv_sec * INT64_C(1000000000)
+            + self.ru_stime.tv_usec * INT64_C(1000);
+        std::ifstream io("/proc/self/io");
+        std::string key;
+        uint64_t value = 0;
+        while (io >> key >> value) {
+            if (key == "read_bytes:") {
+                usage.read_B = value;
+            }
+            else if (key == "write_bytes:") {
+                usage.written_B = value;
+            }
+        }
+#else
+        (void)usage;
+#endif // __linux__
+    };
+    if (macro.setup) {
+        macro.setup();
+    }
+#ifdef __linux__
+    // Resets VmHWM to the current RSS (Linux 4.0), else it is the peak of the process.
+    std::ofstream("/proc/self/clear_refs") << "5";
+#endif // __linux__
+    MacroIteration before;
+    sample(before);
+    const int64_t begin_ns = getSteadyTickStd_ns();
+    macro.operation();
+    const int64_t end_ns = getSteadyTickStd_ns();
+    MacroIteration result;
+    sample(result);
+#ifdef __linux__
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        // VmHWM:     1234 kB
+        if (line.compare(0, 6, "VmHWM:") == 0) {
+            result.peakRss_B = std::stoull(line.substr(6)) * 1024;
+            break;
+        }
+    }
+#endif // __linux__
+    result.time_ns = end_ns - begin_ns;
+    result.user_ns -= before.user_ns;
+    result.system_ns -= before.system_ns;
+    result.rss_B -= before.rss_B;
+    result.read_B -= before.read_B;
+    result.written_B -= before.written_B;
+    result.ok = true;
+    return result;
+}
+
+void Benchmark::runMacro(const uint32_t iterations, const bool inChild) {
+    assert(iterations > 0);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    std::cout << "Macro benchmark is running for " << m_macros.size() * iterations
+        << " subjects:\n";
+#ifndef __linux__
+    if (inChild) {
+        std::cout << "Child processes are supported on Linux only, running in process.\n";
+    }
+#endif // __linux__
+
+    int64_t testeeIdx = 0;
+    std::vector<std::vector<MacroIteration>> results(m_macros.size());
+    for (size_t macroIdx = 0; macroIdx < m_macros.size(); ++macroIdx) {
+        const auto& macro = m_macros[macroIdx];
+        for (uint32_t iteration = 0; iteration < iterations; ++iteration) {
+            std::cout << " [" << testeeIdx++ << "] " << macro.name << " #" << iteration << "... ";
+            std::cout.flush();
+            const int64_t benchmarkIterationBegin_ns = getSteadyTickStd_ns();
+            MacroIteration result;
+#ifdef __linux__
+            int fds[2] = { -1, -1 };
+            if (inChild && pipe(fds) == 0) {
+                std::cout.flush();
+                const pid_t pid = fork();
+                if (pid == 0) {
+                    close(fds[0]);
+                    const MacroIteration child = runMacroIteration(macro);
+                    _exit(write(fds[1], &child, sizeof(child)) == sizeof(child) ? 0 : 1);
+                }
+                close(fds[1]);
+                if (pid > 0) {
+                    if (read(fds[0], &result, sizeof(result)) != sizeof(result)) {
+                        result.ok = false;
+                    }
+                    int status = 0;
+                    waitpid(pid, &status, 0);
+                }
+                close(fds[0]);
+            }
+            else
+#endif // __linux__
+            {
+                result = runMacroIteration(macro);
+            }
+            if (!result.ok) {
+                std::cout << "Failed." << std::endl;
+                continue;
+            }
+            results[macroIdx].push_back(result);
+            std::cout << "Done in " << makeDurationString(
+                    (getSteadyTickStd_ns() - benchmarkIterationBegin_ns) * 1000)
+                << std::endl;
+        }
+    }
+
+    // | Iteration | Time | User | System | RSS delta | Peak RSS | Read | Written |
+    // |----------:|-----:|-----:|-------:|----------:|---------:|-----:|--------:|
+    const auto signedSize = [](const int64_t size_B) -> std::string {
+        return (size_B < 0 ? "-" : "") + makeSizeString(static_cast<uint64_t>(std::abs(size_B)));
+    };
+    for (size_t macroIdx = 0; macroIdx < m_macros.size(); ++macroIdx) {
+        const auto& iterationResults = results[macroIdx];
+        if (iterationResults.empty()) {
+            continue;
+        }
+        std::vector<std::vector<std::string>> rows;
+        std::vector<int64_t> times_ns;
+        for (size_t iteration = 0; iteration < iterationResults.size(); ++iteration) {
+            const auto& result = iterationResults[iteration];
+            times_ns.push_back(result.time_ns);
+            rows.push_back({
+                std::to_string(iteration),
+                makeDurationString(result.time_ns * 1000),
+                makeDurationString(result.user_ns * 1000),
+                makeDurationString(result.system_ns * 1000),
+                signedSize(result.rss_B),
+                result.peakRss_B > 0 ? makeSizeString(result.peakRss_B) : "-",
+                makeSizeString(result.read_B),
+                makeSizeString(result.written_B),
+            });
+        }
+        std::sort(times_ns.begin(), times_ns.end());
+        std::cout << "\n" << m_macros[macroIdx].name << ", min "
+            << makeDurationString(times_ns.front() * 1000) << ", median "
+            << makeDurationString(times_ns[times_ns.size() / 2] * 1000) << ", max "
+            << makeDurationString(times_ns.back() * 1000) << ":\n";
+        printTable({ "Iteration", "Time", "User", "System", "RSS delta", "Peak RSS", "Read",
+            "Written" }, rows, "rrrrrrrr");
+    }
+    std::cout << "\nMacro benchmark finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+void Benchmark::addPlacement(std::string name, const size_t size_B,
+        std::function<void(uint8_t* data, size_t size_B)> setup,
+        std::function<uint32_t(uint32_t random)> testee) {
+    assert(!name.empty());
+    assert(size_B > 0);
+    assert(setup);
+    assert(testee);
+    m_placements.emplace_back();
+    auto& meta = m_placements.back();
+    meta.name = std::move(name);
+    meta.size_B = size_B;
+    meta.setup = std::move(setup);
+    meta.testee.function = std::move(testee);
+}
+
+void Benchmark::setEstimator(const Estimator estimator) {
+    m_estimator = estimator;
+}
+
+void Benchmark::addOffsetSweep(std::string name, const size_t size_B, const Misalign misalign,
+        std::function<uint32_t(uint32_t random, const uint8_t* input, uint8_t* output)> testee) {
+    assert(!name.empty());
+    assert(size_B > 0);
+    assert(testee);
+    m_offsetSweeps.emplace_back();
+    auto& meta = m_offsetSweeps.back();
+    meta.name = std::move(name);
+    meta.size_B = size_B;
+    meta.misalign = misalign;
+    meta.function = std::move(testee);
+}
+
+void Benchmark::addBranchPatterns(std::string name, const uint32_t count,
+        std::function<uint32_t(uint32_t random, const uint8_t* taken, uint32_t count)> testee) {
+    assert(!name.empty());
+    assert(count > 0);
+    assert(testee);
+    m_branchPatterns.emplace_back();
+    auto& meta = m_branchPatterns.back();
+    meta.name = std::move(name);
+    meta.count = count;
+    meta.function = std::move(testee);
+}
+
+void Benchmark::run(const uint32_t timePerTestee_s, const uint32_t minimumRepetitions) {
+    assert(timePerTestee_s > 0);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    std::cout << "Benchmark is running for "
+        << m_testees.size() * m_columns.size() << " subjects:\n";
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerTestee_ns = static_cast<int64_t>(timePerTestee_s) * 1000000000;
+    const int64_t totalTime_ns = timePerTestee_ns * m_testees.size();
+
+    int64_t testeeIdx = 0;
+    for (auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+            auto& testee = itVec.second[columnIdx];
+            const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+            std::cout << " [" << testeeIdx++ << "] " << itVec.first << "... ";
+            if (!testee.function) {
+                std::cout << "Noop." << std::endl;
+                continue;
+            }
+            std::cout.flush();
+
+            m_measuredName = itVec.first + "\t" + m_columns[columnIdx].name;
+            measure(testee, benchmarkTesteeBegin_ns, timePerTestee_ns, minimumRepetitions);
+            m_measuredName.clear();
+
+            std::cout << "Done in " << makeDurationString(
+                    (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1009)
+                << (m_doNotOptimize ? " " : "  ");
+            if (testee.partial) {
+                std::cout << "Partial, " << testee.calls << " calls in the budget. ";
+            }
+            if (testee.timelineDropped > 0) {
+                std::cout << "Timeline dropped " << testee.timelineDropped << " events.";
+            }
+            std::cout << std::endl;
+            addToColumn(columnIdx, testee);
+        }
+    }
+    printTimes();
+
+    bool hasWork = false;
+    for (const auto& itVec : m_testees) {
+        for (const auto& testee : itVec.second) {
+            hasWork |= testee.function && (testee.opsPerCall > 0.0 || testee.bytesPerCall > 0.0);
+        }
+    }
+    if (hasWork) {
+        measureRooflinePeaks(timePerTestee_ns, minimumRepetitions);
+        printRoofline();
+    }
+    printThroughput();
+    if (m_estimator == Estimator::Regression) {
+        printRegression();
+    }
+    if (m_streaming) {
+        printStreamingStatistics();
+    }
+    const int64_t zoneOverhead_ps = measureZoneOverhead(timePerTestee_ns, minimumRepetitions);
+    if (zoneOverhead_ps > 0) {
+        printZones(zoneOverhead_ps);
+    }
+    std::cout << "\nBenchmark finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+void Benchmark::addToColumn(const size_t columnIdx, const TesteeMeta& testee) {
+    auto& column = m_columns[columnIdx];
+    column.minTime_ps = std::min(testee.minimum_ps, column.minTime_ps);
+    column.minTimeStrLength = std::max(column.minTimeStrLength,
+        static_cast<uint32_t>(makeDurationString(testee.minimum_ps).size()));
+    column.maxTime_ps = std::min(testee.maximum_ps, column.maxTime_ps);
+    column.maxTimeStrLength = std::max(column.maxTimeStrLength,
+        static_cast<uint32_t>(makeDurationString(testee.maximum_ps).size()));
+    column.avgTime_ps = std::min(testee.average_ps, column.avgTime_ps);
+    column.avgTimeStrLength = std::max(column.avgTimeStrLength,
+        static_cast<uint32_t>(makeDurationString(testee.average_ps).size()));
+}
+
+// | Name | Time | % | Time | % |
+// |:-----|-----:|--:|-----:|--:|
+// | name | 123s |4.5| 678s |9.0|
+void Benchmark::printTimes() {
+    const auto print = [&](const uint8_t mode) { // 0 - min, 1 - max, 2 - avg
+        std::cout << "| " << std::setw(m_maxNameLength) << std::setfill(' ') << std::left
+            << "Name" << " |";
+        for (size_t columnIdx = 0; columnIdx < m_columns.size(); ++columnIdx) {
+            const auto& column = m_columns[columnIdx];
+            uint32_t timeStrLength = 0;
+            switch (mode) {
+            case 0: timeStrLength = column.minTimeStrLength; break;
+            case 1: timeStrLength = column.maxTimeStrLength; break;
+            case 2: timeStrLength = column.avgTimeStrLength; break;
+            } //                                                                     100.0
+            std::cout << std::setw(timeStrLength + 1) << std::right << column.name << " |   %   |";
+        }
+        std::cout << "\n|:" << std::setw(m_maxNameLength + 1) << std::setfill('-') << "-"
+            << "|";
+        for (size_t columnIdx = 0; columnIdx < m_columns.size(); ++columnIdx) {
+            const auto& column = m_columns[columnIdx];
+            uint32_t timeStrLength = 0;
+            switch (mode) {
+            case 0: timeStrLength = column.minTimeStrLength; break;
+            case 1: timeStrLength = column.maxTimeStrLength; break;
+            case 2: timeStrLength = column.avgTimeStrLength; break;
+            } //                                                                  100.0
+            std::cout << std::setw(timeStrLength + 1) << std::right << "-" << ":|------:|";
+        }
+        std::cout << "\n";
+        for (const auto& itVec : m_testees) {
+            std::cout << "| " << std::setw(m_maxNameLength) << std::setfill(' ')
+                << std::left << itVec.first << " |";
+            for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+                const auto& testee = itVec.second[columnIdx];
+                const auto& column = m_columns[columnIdx];
+                int64_t testeeTime_ps = 0;
+                int64_t time_ps = 0;
+                uint32_t timeStrLength = 0;
+                switch (mode) {
+                case 0:
+                    testeeTime_ps = testee.minimum_ps;
+                    time_ps = column.minTime_ps;
+                    timeStrLength = column.minTimeStrLength;
+                    break;
+                case 1:
+                    testeeTime_ps = testee.maximum_ps;
+                    time_ps = column.maxTime_ps;
+                    timeStrLength = column.maxTimeStrLength;
+                    break;
+                case 2:
+                    testeeTime_ps = testee.average_ps;
+                    time_ps = column.avgTime_ps;
+                    timeStrLength = column.avgTimeStrLength;
+                    break;
+                }
+                if (!testee.function) {
+                    std::cout << std::setw(timeStrLength + 1) << std::right
+                        << "Noop" << " | " << std::setw(5) << "-" << " |";
+                    continue;
+                }
+                const float perc = 0.1f * static_cast<float>(
+                    (testeeTime_ps * 1000) / std::max(time_ps, INT64_C(1))
+                );
+                std::cout << std::setw(timeStrLength + 1) << std::right
+                    << makeDurationString(testeeTime_ps)
+                    << " | " << std::setw(5) << perc << " |";
+            }
+            std::cout << "\n";
+        }
+    };
+    std::cout << "\nMinimum time:\n";
+    print(0);
+    std::cout << "\nMaximum time:\n";
+    print(1);
+    std::cout << "\nAverage time:\n";
+    print(2);
+}
+
+void Benchmark::runWorkingSetSweep(const uint32_t timePerSize_s, const uint32_t llcFactor,
+        const uint32_t minimumRepetitions) {
+    assert(timePerSize_s > 0);
+    assert(llcFactor >= 1);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerSize_ns = static_cast<int64_t>(timePerSize_s) * 1000000000;
+
+    const std::vector<CacheLevel> caches = getCacheLevels();
+    // 1, 1.5, 2, 3, 4, 6, ...
+    std::vector<uint64_t> sizes;
+    const uint64_t first_B = std::max(caches.front().size_B / 4, UINT64_C(1024));
+    const uint64_t last_B = caches.back().size_B * llcFactor;
+    for (uint64_t size_B = first_B; size_B <= last_B; size_B *= 2) {
+        sizes.push_back(size_B);
+        if (size_B + size_B / 2 <= last_B) {
+            sizes.push_back(size_B + size_B / 2);
+        }
+    }
+    std::cout << "Working set sweep is running for "
+        << m_workingSets.size() * sizes.size() << " subjects:\n";
+
+    std::vector<int64_t> averages_ps(m_workingSets.size() * sizes.size(), 0);
+    int64_t testeeIdx = 0;
+    for (size_t workingSetIdx = 0; workingSetIdx < m_workingSets.size(); ++workingSetIdx) {
+        auto& workingSet = m_workingSets[workingSetIdx];
+        for (size_t sizeIdx = 0; sizeIdx < sizes.size(); ++sizeIdx) {
+            std::cout << " [" << testeeIdx++ << "] " << workingSet.name << " "
+                << makeSizeString(sizes[sizeIdx]) << "... ";
+            std::cout.flush();
+            workingSet.setup(static_cast<size_t>(sizes[sizeIdx]));
+
+            const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+            measure(workingSet.testee, benchmarkTesteeBegin_ns, timePerSize_ns,
+                minimumRepetitions);
+            averages_ps[workingSetIdx * sizes.size() + sizeIdx] = workingSet.testee.average_ps;
+
+            std::cout << "Done in " << makeDurationString(
+                    (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+                << (m_doNotOptimize ? " " : "  ") << std::endl;
+        }
+    }
+
+    // | Size | Fits | name | Bytes/s |
+    // |-----:|:-----|-----:|--------:|
+    // | 48KiB| L1   | 1ns  | 64 GB/s |
+    std::vector<std::string> header = { "Size", "Fits" };
+    std::string align = "rl";
+    for (const auto& workingSet : m_workingSets) {
+        header.push_back(workingSet.name);
+        header.push_back("Bytes/s");
+        align += "rr";
+    }
+    std::vector<std::vector<std::string>> rows;
+    for (size_t sizeIdx = 0; sizeIdx < sizes.size(); ++sizeIdx) {
+        std::vector<std::string> row;
+        row.push_back(makeSizeString(sizes[sizeIdx]));
+        std::string fits = "RAM";
+        for (const auto& cache : caches) {
+            if (sizes[sizeIdx] <= cache.size_B) {
+                fits = "L" + std::to_string(cache.level);
+                break;
+            }
+        }
+        row.push_back(fits);
+        for (size_t workingSetIdx = 0; workingSetIdx < m_workingSets.size(); ++workingSetIdx) {
+            const int64_t average_ps = averages_ps[workingSetIdx * sizes.size() + sizeIdx];
+            row.push_back(makeDurationString(average_ps));
+            row.push_back(makeRateString(1e12 * m_workingSets[workingSetIdx].bytesPerCall
+                / std::max(average_ps, INT64_C(1)), "B"));
+        }
+        rows.push_back(std::move(row));
+    }
+    std::cout << "\nWorking set sweep (";
+    for (size_t cacheIdx = 0; cacheIdx < caches.size(); ++cacheIdx) {
+        std::cout << (cacheIdx > 0 ? ", L" : "L") << static_cast<uint32_t>(caches[cacheIdx].level)
+            << " " << makeSizeString(caches[cacheIdx].size_B);
+    }
+    std::cout << "):\n";
+    printTable(header, rows, align);
+    std::cout << "\nWorking set sweep finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+void Benchmark::runPlacements(const uint32_t timePerTestee_s,
+        const uint32_t minimumRepetitions) {
+    assert(timePerTestee_s > 0);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerTestee_ns = static_cast<int64_t>(timePerTestee_s) * 1000000000;
+
+    // A single node is not bound to.
+    const std::vector<uint32_t> nodes = getNumaNodes();
+    struct Placement {
+        Backing backing;
+        int32_t numaNode;
+        std::string label;
+    };
+    std::vector<Placement> placements;
+    static const char* const backingNames[] = { "Normal", "THP", "HugeTLB" };
+    for (uint8_t backing = 0; backing < 3; ++backing) {
+        for (const uint32_t node : nodes) {
+            Placement placement;
+            placement.backing = static_cast<Backing>(backing);
+            placement.numaNode = nodes.size() > 1 ? static_cast<int32_t>(node) : -1;
+            placement.label = backingNames[backing];
+            if (nodes.size() > 1) {
+                placement.label += " n" + std::to_string(node);
+            }
+            placements.push_back(placement);
+        }
+    }
+    std::cout << "Placements benchmark is running for "
+        << m_placements.size() * placements.size() << " subjects:\n";
+
+    // 0 - Noop
+    std::vector<int64_t> averages_ps(m_placements.size() * placements.size(), 0);
+    int64_t testeeIdx = 0;
+    for (size_t placementIdx = 0; placementIdx < m_placements.size(); ++placementIdx) {
+        auto& meta = m_placements[placementIdx];
+        for (size_t columnIdx = 0; columnIdx < placements.size(); ++columnIdx) {
+            const auto& placement = placements[columnIdx];
+            std::cout << " [" << testeeIdx++ << "] " << meta.name << " "
+                << placement.label << "... ";
+            Buffer buffer(meta.size_B, placement.backing, placement.numaNode);
+            if (!buffer) {
+                std::cout << "Noop." << std::endl;
+                continue;
+            }
+            if (buffer.mayUseHugePages()) {
+                std::cout << "MADV_NOHUGEPAGE failed, may use THP... ";
+            }
+            std::cout.flush();
+            meta.setup(buffer.data(), buffer.size());
+
+            const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+            measure(meta.testee, benchmarkTesteeBegin_ns, timePerTestee_ns, minimumRepetitions);
+            averages_ps[placementIdx * placements.size() + columnIdx] =
+                std::max(meta.testee.average_ps, INT64_C(1));
+
+            std::cout << "Done in " << makeDurationString(
+                    (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+                << (m_doNotOptimize ? " " : "  ") << std::endl;
+        }
+    }
+
+    // | Name | Normal |   %   | THP |   %   | HugeTLB |   %   |
+    // |:-----|-------:|------:|----:|------:|--------:|------:|
+    // | name |    1ns |   100 | 1ns |  90.0 |    Noop |     - |
+    std::vector<std::string> header = { "Name" };
+    std::string align = "l";
+    for (const auto& placement : placements) {
+        header.push_back(placement.label);
+        header.push_back("  %  ");
+        align += "rr";
+    }
+    std::vector<std::vector<std::string>> rows;
+    for (size_t placementIdx = 0; placementIdx < m_placements.size(); ++placementIdx) {
+        std::vector<std::string> row = { m_placements[placementIdx].name };
+        const int64_t* const averages = &averages_ps[placementIdx * placements.size()];
+        for (size_t columnIdx = 0; columnIdx < placements.size(); ++columnIdx) {
+            if (averages[columnIdx] == 0) {
+                row.push_back("Noop");
+                row.push_back("-");
+                continue;
+            }
+            row.push_back(makeDurationString(averages[columnIdx]));
+            if (averages[0] == 0) {
+                row.push_back("-");
+                continue;
+            }
+            std::ostringstream perc;
+            perc << 0.1f * static_cast<float>((averages[columnIdx] * 1000) / averages[0]);
+            row.push_back(perc.str());
+        }
+        rows.push_back(std::move(row));
+    }
+    std::cout << "\nAverage time by placement:\n";
+    printTable(header, rows, align);
+    std::cout << "\nPlacements benchmark finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+void Benchmark::runOffsetSweep(const uint32_t timePerOffset_s, const uint32_t maxOffset,
+        const uint32_t step, const uint32_t minimumRepetitions) {
+    assert(timePerOffset_s > 0);
+    assert(step > 0 && step <= maxOffset);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerOffset_ns = static_cast<int64_t>(timePerOffset_s) * 1000000000;
+    const uint32_t offsets = (maxOffset + step - 1) / step;
+    std::cout << "Offset sweep is running for "
+        << m_offsetSweeps.size() * offsets << " subjects:\n";
+
+    std::vector<int64_t> averages_ps(m_offsetSweeps.size() * offsets, 0);
+    int64_t testeeIdx = 0;
+    for (size_t sweepIdx = 0; sweepIdx < m_offsetSweeps.size(); ++sweepIdx) {
+        const auto& sweep = m_offsetSweeps[sweepIdx];
+        Buffer input(sweep.size_B + maxOffset);
+        Buffer output(sweep.size_B + maxOffset);
+        for (size_t idx = 0; idx < input.size(); ++idx) {
+            input.data()[idx] = static_cast<uint8_t>(m_rng());
+        }
+        for (uint32_t offsetIdx = 0; offsetIdx < offsets; ++offsetIdx) {
+            const uint32_t offset = offsetIdx * step;
+            std::cout << " [" << testeeIdx++ << "] " << sweep.name << " +" << offset << "... ";
+            std::cout.flush();
+            const uint8_t* const in = input.data()
+                + (sweep.misalign != Misalign::Output ? offset : 0);
+            uint8_t* const out = output.data()
+                + (sweep.misalign != Misalign::Input ? offset : 0);
+            TesteeMeta testee;
+            testee.function = [&](uint32_t random) -> uint32_t {
+                return sweep.function(random, in, out);
+            };
+            const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+            measure(testee, benchmarkTesteeBegin_ns, timePerOffset_ns, minimumRepetitions);
+            averages_ps[sweepIdx * offsets + offsetIdx] = std::max(testee.average_ps, INT64_C(1));
+
+            std::cout << "Done in " << makeDurationString(
+                    (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+                << (m_doNotOptimize ? " " : "  ") << std::endl;
+        }
+    }
+
+    // | Offset | name |   %   |
+    // |-------:|-----:|------:|
+    // |      0 |  1ns |   100 |
+    std::vector<std::string> header = { "Offset" };
+    std::string align = "r";
+    for (const auto& sweep : m_offsetSweeps) {
+        header.push_back(sweep.name);
+        header.push_back("  %  ");
+        align += "rr";
+    }
+    std::vector<uint32_t> best(m_offsetSweeps.size(), 0);
+    std::vector<uint32_t> worst(m_offsetSweeps.size(), 0);
+    for (size_t sweepIdx = 0; sweepIdx < m_offsetSweeps.size(); ++sweepIdx) {
+        const int64_t* const averages = &averages_ps[sweepIdx * offsets];
+        for (uint32_t offsetIdx = 0; offsetIdx < offsets; ++offsetIdx) {
+            if (averages[offsetIdx] < averages[best[sweepIdx]]) {
+                best[sweepIdx] = offsetIdx;
+            }
+            if (averages[offsetIdx] > averages[worst[sweepIdx]]) {
+                worst[sweepIdx] = offsetIdx;
+            }
+        }
+    }
+    std::vector<std::vector<std::string>> rows;
+    for (uint32_t offsetIdx = 0; offsetIdx < offsets; ++offsetIdx) {
+        std::vector<std::string> row = { std::to_string(offsetIdx * step) };
+        for (size_t sweepIdx = 0; sweepIdx < m_offsetSweeps.size(); ++sweepIdx) {
+            const int64_t* const averages = &averages_ps[sweepIdx * offsets];
+            std::string time = makeDurationString(averages[offsetIdx]);
+            // Markdown highlighting
+            if (offsetIdx == worst[sweepIdx]) {
+                time = "**" + time + "**";
+            }
+            else if (offsetIdx == best[sweepIdx]) {
+                time = "*" + time + "*";
+            }
+            std::ostringstream perc;
+            perc << 0.1f * static_cast<float>(
+                (averages[offsetIdx] * 1000) / averages[best[sweepIdx]]);
+            row.push_back(time);
+            row.push_back(perc.str());
+        }
+        rows.push_back(std::move(row));
+    }
+    std::cout << "\nAverage time by offset:\n";
+    printTable(header, rows, align);
+    std::cout << "\n";
+    for (size_t sweepIdx = 0; sweepIdx < m_offsetSweeps.size(); ++sweepIdx) {
+        const int64_t* const averages = &averages_ps[sweepIdx * offsets];
+        std::cout << m_offsetSweeps[sweepIdx].name
+            << ": best +" << best[sweepIdx] * step
+            << " " << makeDurationString(averages[best[sweepIdx]])
+            << ", worst +" << worst[sweepIdx] * step
+            << " " << makeDurationString(averages[worst[sweepIdx]]) << "\n";
+    }
+    std::cout << "\nOffset sweep finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+Benchmark::PerfCounter::PerfCounter(const uint32_t type, const uint64_t config) noexcept {
+#ifdef __linux__
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#else
+    (void)type;
+    (void)config;
+#endif // __linux__
+}
+
+Benchmark::PerfCounter::~PerfCounter() {
+#ifdef __linux__
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+#endif // __linux__
+}
+
+void Benchmark::PerfCounter::start() noexcept {
+#ifdef __linux__
+    if (m_fd >= 0) {
+        ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif // __linux__
+}
+
+uint64_t Benchmark::PerfCounter::read() const noexcept {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (m_fd >= 0 && ::read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+        count = 0;
+    }
+#endif // __linux__
+    return count;
+}
+
+uint64_t Benchmark::PerfCounter::stop() noexcept {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (m_fd >= 0) {
+        ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+        if (::read(m_fd, &count, sizeof(count)) != sizeof(count)) {
+            count = 0;
+        }
+    }
+#endif // __linux__
+    return count;
+}
+
+void Benchmark::runBranchPatterns(const uint32_t timePerPattern_s, const uint32_t period,
+        const double takenProbability, const double repeatProbability,
+        const uint32_t minimumRepetitions) {
+    assert(timePerPattern_s > 0);
+    assert(period > 0);
+    assert(takenProbability >= 0.0 && takenProbability <= 1.0);
+    assert(repeatProbability >= 0.0 && repeatProbability <= 1.0);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerPattern_ns = static_cast<int64_t>(timePerPattern_s) * 1000000000;
+    const uint32_t patterns = static_cast<uint32_t>(BranchPattern::_count);
+    std::cout << "Branch patterns are running for "
+        << m_branchPatterns.size() * patterns << " subjects:\n";
+
+#ifdef __linux__
+    PerfCounter branchMisses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+#else
+    PerfCounter branchMisses(0, 0);
+#endif // __linux__
+    // Stationary taken rate of Markov: p = r * p + (1 - r) * takenProbability
+    const uint32_t repeatThreshold = static_cast<uint32_t>(repeatProbability * UINT32_MAX);
+    const uint32_t takenThreshold = static_cast<uint32_t>(takenProbability * UINT32_MAX);
+    std::ostringstream markov;
+    markov << "Markov " << std::fixed << std::setprecision(2) << takenProbability
+        << "/" << repeatProbability;
+    const std::string names[] = { "Same", "Periodic " + std::to_string(period),
+        markov.str(), "Random" };
+    std::vector<int64_t> perOutcome_ps(m_branchPatterns.size() * patterns, 0);
+    std::vector<double> missesPerOutcome(m_branchPatterns.size() * patterns, 0.0);
+
+    // The batch passes the same random to each call, so the window
+    // moves by a xorshift of its own on every call.
+    uint32_t cursor = 0;
+    using BranchFunction = std::function<uint32_t(
+        uint32_t random, const uint8_t* taken, uint32_t count)>;
+    const auto wrap = [&cursor](const BranchFunction& function, const uint8_t* taken,
+            const uint32_t spare, const uint32_t count) {
+        return [&cursor, &function, taken, spare, count](uint32_t random) -> uint32_t {
+            cursor ^= cursor << 13;
+            cursor ^= cursor >> 17;
+            cursor ^= cursor << 5;
+            const uint32_t offset = spare > 0 ? cursor % (spare + 1) : 0;
+            return function(random, taken + offset, count);
+        };
+    };
+    // The wrapper with an empty body, without and with the moving window,
+    // is subtracted from the time of each call.
+    const BranchFunction emptyBody = [](uint32_t random, const uint8_t* taken,
+            uint32_t) -> uint32_t {
+        return random ^ static_cast<uint32_t>(reinterpret_cast<uintptr_t>(taken));
+    };
+    const std::vector<uint8_t> emptyTaken((UINT32_C(1) << 16) + 1);
+    int64_t overhead_ps[2] = {};
+    for (uint32_t idx = 0; idx < 2; ++idx) {
+        cursor = m_rng() | 1;
+        TesteeMeta empty;
+        empty.function = wrap(emptyBody, emptyTaken.data(), idx * (UINT32_C(1) << 16), 1);
+        empty.probe = true;
+        measure(empty, getSteadyTickStd_ns(),
+            std::min(timePerPattern_ns, INT64_C(1000000000)), minimumRepetitions);
+        overhead_ps[idx] = empty.average_ps;
+    }
+
+    int64_t testeeIdx = 0;
+    for (size_t branchIdx = 0; branchIdx < m_branchPatterns.size(); ++branchIdx) {
+        const auto& branch = m_branchPatterns[branchIdx];
+        for (uint32_t patternIdx = 0; patternIdx < patterns; ++patternIdx) {
+            const auto pattern = static_cast<BranchPattern>(patternIdx);
+            const uint32_t spare = pattern == BranchPattern::Markov
+                    || pattern == BranchPattern::Random
+                ? std::max(branch.count, UINT32_C(1) << 16) : 0;
+            std::vector<uint8_t> taken(branch.count + spare);
+            uint8_t previous = 1;
+            for (uint32_t idx = 0; idx < taken.size(); ++idx) {
+                switch (pattern) {
+                case BranchPattern::AllSame:
+                    taken[idx] = 1;
+                    break;
+                case BranchPattern::Periodic:
+                    taken[idx] = idx % period == 0;
+                    break;
+                case BranchPattern::Markov:
+                    taken[idx] = m_rng() < repeatThreshold ? previous : m_rng() < takenThreshold;
+                    break;
+                default:
+                    taken[idx] = m_rng() >> 31;
+                    break;
+                }
+                previous = taken[idx];
+            }
+
+            std::cout << " [" << testeeIdx++ << "] " << branch.name
+                << " " << names[patternIdx] << "... ";
+            std::cout.flush();
+            cursor = m_rng() | 1;
+            TesteeMeta testee;
+            testee.function = wrap(branch.function, taken.data(), spare, branch.count);
+            const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+            branchMisses.start();
+            measure(testee, benchmarkTesteeBegin_ns, timePerPattern_ns, minimumRepetitions);
+            const uint64_t misses = branchMisses.stop();
+            const size_t cellIdx = branchIdx * patterns + patternIdx;
+            perOutcome_ps[cellIdx] = std::max<int64_t>(
+                testee.average_ps - overhead_ps[spare > 0 ? 1 : 0], 0) / branch.count;
+            if (testee.calls > 0) {
+                missesPerOutcome[cellIdx] = static_cast<double>(misses)
+                    / (static_cast<double>(testee.calls) * branch.count);
+            }
+
+            std::cout << "Done in " << makeDurationString(
+                    (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+                << (m_doNotOptimize ? " " : "  ") << std::endl;
+        }
+    }
+
+    // | Name | Same | Misses | Periodic 16 | Misses | Markov 0.50/0.90 | Misses | Random | Misses |
+    // |:-----|-----:|-------:|------------:|-------:|------------:|-------:|-------:|-------:|
+    std::vector<std::string> header = { "Name" };
+    std::string align = "l";
+    for (uint32_t patternIdx = 0; patternIdx < patterns; ++patternIdx) {
+        header.push_back(names[patternIdx]);
+        align += "r";
+        if (branchMisses) {
+            header.push_back("Misses");
+            align += "r";
+        }
+    }
+    std::vector<std::vector<std::string>> rows;
+    for (size_t branchIdx = 0; branchIdx < m_branchPatterns.size(); ++branchIdx) {
+        std::vector<std::string> row = { m_branchPatterns[branchIdx].name };
+        for (uint32_t patternIdx = 0; patternIdx < patterns; ++patternIdx) {
+            const size_t cellIdx = branchIdx * patterns + patternIdx;
+            row.push_back(makeDurationString(perOutcome_ps[cellIdx]));
+            if (branchMisses) {
+                std::ostringstream misses;
+                misses << std::fixed << std::setprecision(3) << missesPerOutcome[cellIdx];
+                row.push_back(misses.str());
+            }
+        }
+        rows.push_back(std::move(row));
+    }
+    std::cout << "\nAverage time per outcome:\n";
+    printTable(header, rows, align);
+    std::cout << "\nBranch patterns finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+const char* Benchmark::toString(const Access access) noexcept {
+    switch (access) {
+    case Access::Read: return "read";
+    case Access::Write: return "write";
+    case Access::Rmw: return "rmw";
+    }
+    return "";
+}
+
+bool Benchmark::pinThread(const uint32_t cpu) noexcept {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif // __linux__
+}
+
+template <Benchmark::Access A>
+uint64_t Benchmark::access(std::atomic<uint64_t>& variable, const uint64_t value) noexcept {
+    switch (A) {
+    case Access::Read:
+        return variable.load(std::memory_order_relaxed);
+    case Access::Write:
+        variable.store(value, std::memory_order_relaxed);
+        return value;
+    case Access::Rmw:
+        return variable.fetch_add(value, std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+uint64_t Benchmark::accessMany(const Access access,
+        std::atomic<uint64_t>& variable, const uint64_t value) noexcept {
+    uint64_t sum = 0;
+    switch (access) {
+    case Access::Read:
+        for (uint32_t idx = 0; idx < contentionOpsPerCall; ++idx) {
+            sum += Benchmark::access<Access::Read>(variable, value);
+        }
+        break;
+    case Access::Write:
+        for (uint32_t idx = 0; idx < contentionOpsPerCall; ++idx) {
+            sum += Benchmark::access<Access::Write>(variable, value + idx);
+        }
+        break;
+    case Access::Rmw:
+        for (uint32_t idx = 0; idx < contentionOpsPerCall; ++idx) {
+            sum += Benchmark::access<Access::Rmw>(variable, value);
+        }
+        break;
+    }
+    return sum;
+}
+
+void Benchmark::runContention(const uint32_t threads, const std::vector<uint32_t>& distances_B,
+        const std::vector<AccessMix>& mixes, const uint32_t timePerCell_s,
+        const uint32_t minimumRepetitions) {
+    assert(threads >= 1);
+    assert(!distances_B.empty());
+    assert(!mixes.empty());
+    assert(timePerCell_s > 0);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerCell_ns = static_cast<int64_t>(timePerCell_s) * 1000000000;
+    const uint32_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+    if (threads > cpus) {
+        std::cout << threads << " threads on " << cpus
+            << " CPUs, some threads share a CPU with the measured thread 0.\n";
+    }
+    std::cout << "Contention probe is running for " << distances_B.size() * mixes.size()
+        << " subjects on " << threads << " threads and " << cpus << " CPUs:\n";
+
+    // [distance][mix]
+    std::vector<int64_t> perOp_ps(distances_B.size() * mixes.size(), 0);
+    std::vector<double> opsPerSecond(distances_B.size() * mixes.size(), 0.0);
+    int64_t testeeIdx = 0;
+    for (size_t distanceIdx = 0; distanceIdx < distances_B.size(); ++distanceIdx) {
+        const uint32_t distance_B = distances_B[distanceIdx];
+        assert(distance_B % sizeof(uint64_t) == 0);
+        Buffer buffer(static_cast<size_t>(distance_B) * threads + sizeof(uint64_t));
+        std::vector<std::atomic<uint64_t>*> variables(threads);
+        for (uint32_t threadIdx = 0; threadIdx < threads; ++threadIdx) {
+            variables[threadIdx] = new (buffer.data() + static_cast<size_t>(distance_B) * threadIdx)
+                std::atomic<uint64_t>(0);
+        }
+        for (size_t mixIdx = 0; mixIdx < mixes.size(); ++mixIdx) {
+            const auto& mix = mixes[mixIdx];
+            std::cout << " [" << testeeIdx++ << "] " << distance_B << "B "
+                << toString(mix.measured) << "/" << toString(mix.others) << "... ";
+            std::cout.flush();
+
+            // The throughput counts the main measurement of thread 0 only: the
+            // background threads count their operations between its begin and end.
+            enum : uint32_t { Calibrating, Main, Stopped };
+            std::atomic<uint32_t> running(0);
+            std::atomic<uint32_t> phase(Calibrating);
+            std::vector<uint64_t> backgroundOps(threads, 0);
+            std::vector<std::thread> background;
+            for (uint32_t threadIdx = 1; threadIdx < threads; ++threadIdx) {
+                background.emplace_back([&, threadIdx]() {
+                    pinThread(threadIdx % cpus);
+                    auto& variable = *variables[threadIdx];
+                    uint64_t ops = 0;
+                    uint64_t mainOps = UINT64_MAX;
+                    uint64_t sum = 0;
+                    running.fetch_add(1);
+                    for (uint32_t current = Calibrating; current != Stopped;
+                            current = phase.load(std::memory_order_relaxed)) {
+                        if (current == Main && mainOps == UINT64_MAX) {
+                            mainOps = ops;
+                        }
+                        sum += accessMany(mix.others, variable, ops);
+                        ops += contentionOpsPerCall;
+                    }
+                    volatile uint64_t sink = sum;
+                    (void)sink;
+                    backgroundOps[threadIdx] = mainOps == UINT64_MAX ? 0 : ops - mainOps;
+                });
+            }
+            TesteeMeta testee;
+            int64_t elapsed_ns = 0;
+            uint64_t mainCalls = 0;
+            int64_t mainBegin_ns = 0;
+            int64_t mainEnd_ns = 0;
+            // Not on the calling thread to keep its affinity.
+            std::thread([&]() {
+                pinThread(0);
+                while (running.load() != threads - 1) {
+                    std::this_thread::yield();
+                }
+                auto& variable = *variables[0];
+                testee.function = [&](uint32_t random) -> uint32_t {
+                    return static_cast<uint32_t>(accessMany(mix.measured, variable, random));
+                };
+                testee.mainBegins = [&]() {
+                    mainCalls = testee.calls;
+                    phase.store(Main);
+                    mainBegin_ns = getSteadyTickStd_ns();
+                };
+                testee.mainEnds = [&]() {
+                    mainEnd_ns = getSteadyTickStd_ns();
+                    phase.store(Stopped);
+                };
+                const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+                measure(testee, benchmarkTesteeBegin_ns, timePerCell_ns, minimumRepetitions);
+                phase.store(Stopped);
+                elapsed_ns = getSteadyTickStd_ns() - benchmarkTesteeBegin_ns;
+            }).join();
+            for (auto& thread : background) {
+                thread.join();
+            }
+
+            const size_t cellIdx = distanceIdx * mixes.size() + mixIdx;
+            perOp_ps[cellIdx] = testee.average_ps / contentionOpsPerCall;
+            uint64_t ops = (testee.calls - mainCalls) * contentionOpsPerCall;
+            for (const uint64_t threadOps : backgroundOps) {
+                ops += threadOps;
+            }
+            if (mainEnd_ns > mainBegin_ns) {
+                opsPerSecond[cellIdx] = 1e9 * static_cast<double>(ops)
+                    / (mainEnd_ns - mainBegin_ns);
+            }
+
+            std::cout << "Done in " << makeDurationString(elapsed_ns * 1000)
+                << (m_doNotOptimize ? " " : "  ") << std::endl;
+        }
+    }
+
+    // | Distance | read/write | Throughput | ... |
+    // |---------:|-----------:|-----------:|-----|
+    std::vector<std::string> header = { "Distance" };
+    std::string align = "r";
+    for (const auto& mix : mixes) {
+        header.push_back(std::string(toString(mix.measured)) + "/" + toString(mix.others));
+        header.push_back("Throughput");
+        align += "rr";
+    }
+    std::vector<std::vector<std::string>> rows;
+    for (size_t distanceIdx = 0; distanceIdx < distances_B.size(); ++distanceIdx) {
+        std::vector<std::string> row = { std::to_string(distances_B[distanceIdx]) + "B" };
+        for (size_t mixIdx = 0; mixIdx < mixes.size(); ++mixIdx) {
+            const size_t cellIdx = distanceIdx * mixes.size() + mixIdx;
+            row.push_back(makeDurationString(perOp_ps[cellIdx]));
+            row.push_back(makeRateString(opsPerSecond[cellIdx], "ops"));
+        }
+        rows.push_back(std::move(row));
+    }
+    std::cout << "\nTime per operation of thread 0 and throughput of " << threads
+        << " threads:\n";
+    printTable(header, rows, align);
+    std::cout << "\nContention probe finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+void Benchmark::runCoreToCore(const uint32_t timePerPair_ms, const std::string& csvPath,
+        std::vector<uint32_t> cpus, const uint32_t minimumRepetitions) {
+    assert(timePerPair_ms > 0);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerPair_ns = static_cast<int64_t>(timePerPair_ms) * 1000000;
+    if (cpus.empty()) {
+        for (uint32_t cpu = 0; cpu < std::max(std::thread::hardware_concurrency(), 1u); ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+    const size_t count = cpus.size();
+    std::cout << "Core-to-core latency is running for " << count * (count - 1) / 2
+        << " subjects:\n";
+
+    // Own page, away from anything else.
+    Buffer buffer(sizeof(std::atomic<uint64_t>));
+    auto& flag = *new (buffer.data()) std::atomic<uint64_t>(0);
+    // Yields when a CPU is shared by both threads.
+    const auto waitFor = [&](const uint64_t value, const std::atomic<bool>* stop) -> bool {
+        for (uint32_t spins = 1; flag.load(std::memory_order_acquire) != value; ++spins) {
+            if (spins % 1024 == 0) {
+                if (stop && stop->load(std::memory_order_relaxed)) {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+        }
+        return true;
+    };
+
+    // [from][to], 0 - the same CPU, -1 - a thread could not be pinned
+    std::vector<int64_t> roundTrip_ps(count * count, 0);
+    int64_t testeeIdx = 0;
+    for (size_t fromIdx = 0; fromIdx < count; ++fromIdx) {
+        for (size_t toIdx = fromIdx + 1; toIdx < count; ++toIdx) {
+            std::cout << " [" << testeeIdx++ << "] " << cpus[fromIdx] << " <-> "
+                << cpus[toIdx] << "... ";
+            std::cout.flush();
+            flag.store(0);
+            std::atomic<bool> stop(false);
+            // 0 - pending, 1 - pinned, 2 - failed
+            std::atomic<uint32_t> pongPinned(0);
+            // Answers odd values with the next even one.
+            std::thread pong([&]() {
+                const bool pinned = pinThread(cpus[toIdx]);
+                pongPinned.store(pinned ? 1 : 2);
+                if (!pinned) {
+                    return;
+                }
+                for (uint64_t value = 1; waitFor(value, &stop); value += 2) {
+                    flag.store(value + 1, std::memory_order_release);
+                }
+            });
+            TesteeMeta testee;
+            int64_t elapsed_ns = 0;
+            bool pinned = false;
+            std::thread([&]() {
+                pinned = pinThread(cpus[fromIdx]);
+                while (pongPinned.load() == 0) {
+                    std::this_thread::yield();
+                }
+                // Else the scheduler would pick the cores of the pair.
+                if (!pinned || pongPinned.load() != 1) {
+                    pinned = false;
+                    return;
+                }
+                uint64_t value = 0;
+                testee.function = [&](uint32_t) -> uint32_t {
+                    for (uint32_t idx = 0; idx < pingPongsPerCall; ++idx) {
+                        flag.store(value + 1, std::memory_order_release);
+                        value += 2;
+                        waitFor(value, nullptr);
+                    }
+                    return static_cast<uint32_t>(value);
+                };
+                const int64_t benchmarkPairBegin_ns = getSteadyTickStd_ns();
+                measure(testee, benchmarkPairBegin_ns, timePerPair_ns, minimumRepetitions);
+                elapsed_ns = getSteadyTickStd_ns() - benchmarkPairBegin_ns;
+            }).join();
+            stop.store(true);
+            pong.join();
+            roundTrip_ps[fromIdx * count + toIdx] = pinned
+                ? testee.average_ps / pingPongsPerCall : -1;
+            roundTrip_ps[toIdx * count + fromIdx] = roundTrip_ps[fromIdx * count + toIdx];
+            if (!pinned) {
+                std::cout << "Failed to pin." << std::endl;
+                continue;
+            }
+
+            std::cout << "Done in " << makeDurationString(elapsed_ns * 1000)
+                << (m_doNotOptimize ? " " : "  ") << std::endl;
+        }
+    }
+
+    // | From\To | 0 | 1 |
+    // |--------:|--:|--:|
+    // |       0 | - | 9 |
+    std::vector<std::string> header = { "From\\To" };
+    std::string align = "r";
+    for (const uint32_t cpu : cpus) {
+        header.push_back(std::to_string(cpu));
+        align += "r";
+    }
+    const auto print = [&](const char* title, const int64_t divisor) {
+        std::vector<std::vector<std::string>> rows;
+        for (size_t fromIdx = 0; fromIdx < count; ++fromIdx) {
+            std::vector<std::string> row = { std::to_string(cpus[fromIdx]) };
+            for (size_t toIdx = 0; toIdx < count; ++toIdx) {
+                const int64_t latency_ps = roundTrip_ps[fromIdx * count + toIdx] / divisor;
+                std::ostringstream cell;
+                if (fromIdx == toIdx || roundTrip_ps[fromIdx * count + toIdx] < 0) {
+                    cell << "-";
+                }
+                else {
+                    cell << std::fixed << std::setprecision(1) << latency_ps / 1000.0;
+                }
+                row.push_back(cell.str());
+            }
+            rows.push_back(std::move(row));
+        }
+        std::cout << "\n" << title << " latency, ns:\n";
+        printTable(header, rows, align);
+    };
+    print("Round-trip", 1);
+    print("One-way", 2);
+
+    if (!csvPath.empty()) {
+        std::ofstream csv(csvPath);
+        csv << "from,to,round_trip_ns,one_way_ns\n";
+        // One row per measured pair, the matrices mirror it.
+        for (size_t fromIdx = 0; fromIdx < count; ++fromIdx) {
+            for (size_t toIdx = fromIdx + 1; toIdx < count; ++toIdx) {
+                const int64_t latency_ps = roundTrip_ps[fromIdx * count + toIdx];
+                if (latency_ps < 0) {
+                    continue;
+                }
+                csv << cpus[fromIdx] << "," << cpus[toIdx] << "," << latency_ps / 1000.0
+                    << "," << latency_ps / 2000.0 << "\n";
+            }
+        }
+        std::cout << (csv ? "\nExported to " : "\nFailed to export to ") << csvPath << "\n";
+    }
+    std::cout << "\nCore-to-core latency finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+const char* Benchmark::toString(const Interference interference) noexcept {
+    switch (interference) {
+    case Interference::MemoryHog: return "Memory hog";
+    case Interference::LlcThrasher: return "LLC thrasher";
+    case Interference::ComputeHog: return "Compute hog";
+    case Interference::SyscallStorm: return "Syscall storm";
+    case Interference::_count: break;
+    }
+    return "";
+}
+
+std::vector<uint32_t> Benchmark::getSmtSiblings(const uint32_t cpu) {
+    std::vector<uint32_t> result;
+#ifdef __linux__
+    // 0,4 or 0-1
+    std::string siblings;
+    std::ifstream("/sys/devices/system/cpu/cpu" + std::to_string(cpu)
+        + "/topology/thread_siblings_list") >> siblings;
+    for (char& c : siblings) {
+        if (c == ',') {
+            c = ' ';
+        }
+    }
+    std::istringstream ranges(siblings);
+    std::string range;
+    while (ranges >> range) {
+        char* end = nullptr;
+        const uint32_t first = static_cast<uint32_t>(std::strtoul(range.c_str(), &end, 10));
+        const uint32_t last = *end == '-'
+            ? static_cast<uint32_t>(std::strtoul(end + 1, nullptr, 10)) : first;
+        for (uint32_t sibling = first; sibling <= last && end != range.c_str(); ++sibling) {
+            if (sibling != cpu) {
+                result.push_back(sibling);
+            }
+        }
+    }
+#else
+    (void)cpu;
+#endif // __linux__
+    return result;
+}
+
+void Benchmark::interfere(const Interference interference, uint8_t* data,
+        const size_t size_B, const std::atomic<bool>& stop) {
+    lcg32 rng(static_cast<uint32_t>(getSteadyTickStd_ns()));
+    uint64_t sum = 0;
+    while (!stop.load(std::memory_order_relaxed)) {
+        switch (interference) {
+        case Interference::MemoryHog:
+            std::memcpy(data, data + size_B / 2, size_B / 2);
+            std::memcpy(data + size_B / 2, data, size_B / 2);
+            break;
+        case Interference::LlcThrasher:
+            for (uint32_t idx = 0; idx < 4096; ++idx) {
+                uint8_t& line = data[(rng() % (size_B / 64)) * 64];
+                line = static_cast<uint8_t>(line + 1);
+            }
+            break;
+        case Interference::ComputeHog: {
+            uint64_t a = sum | 1, b = a + 1, c = a + 2, d = a + 3;
+            for (uint32_t idx = 0; idx < 4096; ++idx) {
+                a *= b; b *= c; c *= d; d *= a;
+            }
+            sum += a + b + c + d;
+            break;
+        }
+        case Interference::SyscallStorm:
+            for (uint32_t idx = 0; idx < 64; ++idx) {
+#             ifdef __linux__
+                sum += static_cast<uint64_t>(syscall(SYS_getppid));
+#             else
+                std::this_thread::yield();
+#             endif // __linux__
+            }
+            break;
+        case Interference::_count:
+            return;
+        }
+    }
+    data[0] = static_cast<uint8_t>(data[0] + sum);
+}
+
+void Benchmark::runInterference(const uint32_t workers, const uint32_t timePerTestee_s,
+        const std::vector<Interference>& interferences, const uint32_t minimumRepetitions) {
+    assert(workers >= 1);
+    assert(timePerTestee_s > 0);
+    assert(!interferences.empty());
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerTestee_ns = static_cast<int64_t>(timePerTestee_s) * 1000000000;
+    const uint32_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+    // The compute hog shares the core of CPU 0 on its sibling first, the other
+    // interferences go to the other cores first, so they do not share L1/L2.
+    const std::vector<uint32_t> siblings = getSmtSiblings(0);
+    std::vector<uint32_t> otherCores;
+    for (uint32_t cpu = 1; cpu < cpus; ++cpu) {
+        if (std::find(siblings.begin(), siblings.end(), cpu) == siblings.end()) {
+            otherCores.push_back(cpu);
+        }
+    }
+    std::vector<uint32_t> computeCpus = siblings;
+    computeCpus.insert(computeCpus.end(), otherCores.begin(), otherCores.end());
+    std::vector<uint32_t> workerCpus = otherCores;
+    workerCpus.insert(workerCpus.end(), siblings.begin(), siblings.end());
+    if (workerCpus.empty()) {
+        workerCpus.push_back(0);
+        computeCpus.push_back(0);
+    }
+    const uint64_t llc_B = getCacheLevels().back().size_B;
+    std::cout << "Interference is running for "
+        << m_testees.size() * m_columns.size() * (interferences.size() + 1)
+        << " subjects with " << workers << " workers:\n";
+
+    // [cell][0 - quiet, interferences...], 0 - Noop
+    std::vector<std::vector<int64_t>> averages_ps;
+    int64_t testeeIdx = 0;
+    for (auto& itVec : m_testees) {
+        for (auto& testee : itVec.second) {
+            averages_ps.emplace_back(interferences.size() + 1, 0);
+            for (size_t modeIdx = 0; modeIdx <= interferences.size(); ++modeIdx) {
+                std::cout << " [" << testeeIdx++ << "] " << itVec.first << " "
+                    << (modeIdx == 0 ? "quiet" : toString(interferences[modeIdx - 1]))
+                    << "... ";
+                if (!testee.function) {
+                    std::cout << "Noop." << std::endl;
+                    continue;
+                }
+                std::cout.flush();
+
+                std::atomic<bool> stop(false);
+                std::vector<Buffer> buffers;
+                std::vector<std::thread> background;
+                for (uint32_t workerIdx = 0; modeIdx > 0 && workerIdx < workers; ++workerIdx) {
+                    const Interference interference = interferences[modeIdx - 1];
+                    buffers.emplace_back(interference == Interference::MemoryHog
+                        ? llc_B * 4 : std::max(llc_B, UINT64_C(4096)));
+                    uint8_t* const data = buffers.back().data();
+                    const size_t size_B = buffers.back().size();
+                    const auto& placement = interference == Interference::ComputeHog
+                        ? computeCpus : workerCpus;
+                    const uint32_t cpu = placement[workerIdx % placement.size()];
+                    background.emplace_back([&stop, interference, data, size_B, cpu]() {
+                        pinThread(cpu);
+                        interfere(interference, data, size_B, stop);
+                    });
+                }
+                const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+                std::thread([&]() {
+                    pinThread(0);
+                    measure(testee, benchmarkTesteeBegin_ns, timePerTestee_ns, minimumRepetitions);
+                }).join();
+                stop.store(true);
+                for (auto& thread : background) {
+                    thread.join();
+                }
+                averages_ps.back()[modeIdx] = std::max(testee.average_ps, INT64_C(1));
+
+                std::cout << "Done in " << makeDurationString(
+                        (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+                    << (m_doNotOptimize ? " " : "  ") << std::endl;
+            }
+        }
+    }
+
+    // | Name | Quiet | Memory hog | Slowdown % | ... |
+    // |:-----|------:|-----------:|-----------:|-----|
+    std::vector<std::string> header = { "Name", "Quiet" };
+    std::string align = "lr";
+    for (const auto interference : interferences) {
+        header.push_back(toString(interference));
+        header.push_back("Slowdown %");
+        align += "rr";
+    }
+    std::vector<std::vector<std::string>> rows;
+    size_t cellIdx = 0;
+    for (const auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx, ++cellIdx) {
+            std::string name = itVec.first;
+            if (m_columns.size() > 1) {
+                name += " " + m_columns[columnIdx].name;
+            }
+            const auto& cell = averages_ps[cellIdx];
+            std::vector<std::string> row = { name,
+                cell[0] > 0 ? makeDurationString(cell[0]) : "Noop" };
+            for (size_t modeIdx = 1; modeIdx < cell.size(); ++modeIdx) {
+                if (cell[0] == 0) {
+                    row.insert(row.end(), { "Noop", "-" });
+                    continue;
+                }
+                std::ostringstream slowdown;
+                slowdown << std::fixed << std::setprecision(1)
+                    << 100.0 * static_cast<double>(cell[modeIdx] - cell[0]) / cell[0];
+                row.push_back(makeDurationString(cell[modeIdx]));
+                row.push_back(slowdown.str());
+            }
+            rows.push_back(std::move(row));
+        }
+    }
+    std::cout << "\nAverage time by interference:\n";
+    printTable(header, rows, align);
+    std::cout << "\nInterference finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+void Benchmark::runCoRun(const bool smtSibling, const uint32_t timePerPair_s,
+        const uint32_t minimumRepetitions) {
+    assert(timePerPair_s > 0);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerPair_ns = static_cast<int64_t>(timePerPair_s) * 1000000000;
+    const uint32_t cpus = std::max(std::thread::hardware_concurrency(), 1u);
+    const std::vector<uint32_t> siblings = getSmtSiblings(0);
+    uint32_t partnerCpu = 0;
+    if (smtSibling && !siblings.empty()) {
+        partnerCpu = siblings.front();
+    }
+    else {
+        for (uint32_t cpu = 1; cpu < cpus && partnerCpu == 0; ++cpu) {
+            if (std::find(siblings.begin(), siblings.end(), cpu) == siblings.end()) {
+                partnerCpu = cpu;
+            }
+        }
+        if (partnerCpu == 0 && !siblings.empty()) {
+            partnerCpu = siblings.front();
+        }
+        if (partnerCpu == 0) {
+            std::cout << "Only CPU 0, the partner would share it with the measured testee.\n";
+        }
+        else if (smtSibling) {
+            std::cout << "CPU 0 has no SMT sibling, the partner runs on CPU "
+                << partnerCpu << ".\n";
+        }
+        else if (partnerCpu == siblings.front()) {
+            std::cout << "No other core, the partner runs on the SMT sibling "
+                << partnerCpu << ".\n";
+        }
+    }
+
+    std::vector<std::pair<std::string, TesteeMeta*>> cells;
+    for (auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+            if (!itVec.second[columnIdx].function) {
+                continue;
+            }
+            std::string name = itVec.first;
+            if (m_columns.size() > 1) {
+                name += " " + m_columns[columnIdx].name;
+            }
+            cells.emplace_back(std::move(name), &itVec.second[columnIdx]);
+        }
+    }
+    const size_t count = cells.size();
+    // A partner sharing CPU 0 is not measured.
+    const size_t partners = partnerCpu != 0 ? count : 0;
+    std::cout << "Co-run is running for " << count * (partners + 1)
+        << " subjects on CPUs 0 and " << partnerCpu << ":\n";
+
+    // [measured][0 - alone, 1 + partner], 0 - not measured
+    std::vector<int64_t> averages_ps(count * (count + 1), 0);
+    int64_t testeeIdx = 0;
+    for (size_t measuredIdx = 0; measuredIdx < count; ++measuredIdx) {
+        auto& testee = *cells[measuredIdx].second;
+        for (size_t partnerIdx = 0; partnerIdx <= partners; ++partnerIdx) {
+            std::cout << " [" << testeeIdx++ << "] " << cells[measuredIdx].first << " + "
+                << (partnerIdx == 0 ? "alone" : cells[partnerIdx - 1].first) << "... ";
+            std::cout.flush();
+
+            std::atomic<bool> stop(false);
+            std::thread partner;
+            // Read after the join, m_doNotOptimize belongs to the measuring thread.
+            uint32_t partnerDoNotOptimize = 0;
+            if (partnerIdx > 0) {
+                const auto& function = cells[partnerIdx - 1].second->function;
+                partner = std::thread([&]() {
+                    pinThread(partnerCpu);
+                    lcg32 rng(static_cast<uint32_t>(getSteadyTickStd_ns()));
+                    uint32_t doNotOptimize = 0;
+                    while (!stop.load(std::memory_order_relaxed)) {
+                        doNotOptimize += function(rng());
+                    }
+                    partnerDoNotOptimize = doNotOptimize;
+                });
+            }
+            const int64_t benchmarkPairBegin_ns = getSteadyTickStd_ns();
+            std::thread([&]() {
+                pinThread(0);
+                measure(testee, benchmarkPairBegin_ns, timePerPair_ns, minimumRepetitions);
+            }).join();
+            stop.store(true);
+            if (partner.joinable()) {
+                partner.join();
+                m_doNotOptimize += partnerDoNotOptimize & 1;
+            }
+            averages_ps[measuredIdx * (count + 1) + partnerIdx]
+                = std::max(testee.average_ps, INT64_C(1));
+
+            std::cout << "Done in " << makeDurationString(
+                    (getSteadyTickStd_ns() - benchmarkPairBegin_ns) * 1000)
+                << (m_doNotOptimize ? " " : "  ") << std::endl;
+        }
+    }
+
+    // | Measured \ Beside | Alone | a | b |
+    // |:------------------|------:|--:|--:|
+    // | a                 |   1ns | 5 | 9 |
+    std::vector<std::string> header = { "Measured \\ Beside", "Alone" };
+    std::string align = "lr";
+    for (const auto& cell : cells) {
+        header.push_back(cell.first);
+        align += "r";
+    }
+    std::vector<std::vector<std::string>> rows;
+    for (size_t measuredIdx = 0; measuredIdx < count; ++measuredIdx) {
+        const int64_t* const averages = &averages_ps[measuredIdx * (count + 1)];
+        std::vector<std::string> row = { cells[measuredIdx].first,
+            makeDurationString(averages[0]) };
+        for (size_t partnerIdx = 1; partnerIdx <= count; ++partnerIdx) {
+            if (averages[partnerIdx] == 0) {
+                row.push_back("-");
+                continue;
+            }
+            std::ostringstream slowdown;
+            slowdown << std::fixed << std::setprecision(1)
+                << 100.0 * static_cast<double>(averages[partnerIdx] - averages[0]) / averages[0];
+            row.push_back(slowdown.str());
+        }
+        rows.push_back(std::move(row));
+    }
+    std::cout << "\nSlowdown %, of the measured testee beside the other:\n";
+    printTable(header, rows, align);
+    std::cout << "\nCo-run finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+double Benchmark::runSchedule(const std::function<uint32_t(uint32_t random)>& function,
+        const std::function<int64_t(uint64_t call)>& schedule_ns, const int64_t time_ns,
+        Histogram& histogram) {
+    histogram.reset();
+    uint32_t doNotOptimize = 0;
+    const int64_t begin_ns = getSteadyTick_ns();
+    const int64_t end_ns = begin_ns + time_ns;
+    uint64_t issued = 0;
+    int64_t intended_ns = begin_ns;
+    int64_t now_ns = begin_ns;
+    while (true) {
+        intended_ns = schedule_ns ? begin_ns + schedule_ns(issued) : now_ns;
+        // A call due after the end is not waited for.
+        const int64_t until_ns = std::min(intended_ns, end_ns);
+        if (now_ns < until_ns) {
+            now_ns = waitUntil(until_ns);
+        }
+        if (now_ns >= end_ns) {
+            break;
+        }
+        doNotOptimize += function(m_rng());
+        now_ns = getSteadyTick_ns();
+        histogram.record(static_cast<uint64_t>(now_ns - intended_ns));
+        ++issued;
+    }
+    const uint64_t completed = issued;
+    // The calls due but never issued are waiting at least until the end.
+    for (; schedule_ns && intended_ns < end_ns;
+            intended_ns = begin_ns + schedule_ns(++issued)) {
+        histogram.record(static_cast<uint64_t>(now_ns - intended_ns));
+    }
+    m_doNotOptimize += doNotOptimize;
+    return 1e9 * completed / (now_ns - begin_ns);
+}
+
+double Benchmark::runClosedLoop(const std::function<uint32_t(uint32_t random)>& function,
+        const int64_t interval_ns, const int64_t time_ns, Histogram& histogram) {
+    assert(interval_ns > 0);
+    histogram.reset();
+    uint32_t doNotOptimize = 0;
+    const int64_t begin_ns = getSteadyTick_ns();
+    const int64_t end_ns = begin_ns + time_ns;
+    uint64_t completed = 0;
+    int64_t now_ns = begin_ns;
+    int64_t due_ns = begin_ns;
+    while (now_ns < end_ns) {
+        const int64_t start_ns = now_ns;
+        doNotOptimize += function(m_rng());
+        now_ns = getSteadyTick_ns();
+        // The next call waits for this one, its waiting is not seen otherwise.
+        histogram.recordCorrected(static_cast<uint64_t>(now_ns - start_ns),
+            static_cast<uint64_t>(interval_ns));
+        ++completed;
+        // From the due time, a late wake-up does not lower the rate. A late
+        // call moves it, the calls held back are not caught up.
+        due_ns = std::max(due_ns + interval_ns, now_ns);
+        if (now_ns < due_ns) {
+            now_ns = waitUntil(std::min(due_ns, end_ns));
+        }
+    }
+    m_doNotOptimize += doNotOptimize;
+    return 1e9 * completed / (now_ns - begin_ns);
+}
+
+int64_t Benchmark::waitUntil(const int64_t tick_ns) noexcept {
+    // The wake-up from a sleep may be late by tens of microseconds.
+    constexpr int64_t spin_ns = 200000;
+    int64_t now_ns = getSteadyTick_ns();
+    if (tick_ns - now_ns > spin_ns) {
+        std::this_thread::sleep_for(std::chrono::nanoseconds(tick_ns - now_ns - spin_ns));
+        now_ns = getSteadyTick_ns();
+    }
+    while (now_ns < tick_ns) {
+        now_ns = getSteadyTick_ns();
+    }
+    return now_ns;
+}
+
+std::vector<std::string> Benchmark::makeLatencyRow(const double offered_Hz,
+        const double achieved_Hz, const Histogram& histogram) {
+    return {
+        makeRateString(offered_Hz, ""),
+        makeRateString(achieved_Hz, ""),
+        makeDurationString(histogram.percentile(50.0) * 1000),
+        makeDurationString(histogram.percentile(90.0) * 1000),
+        makeDurationString(histogram.percentile(99.0) * 1000),
+        makeDurationString(histogram.percentile(99.9) * 1000),
+        makeDurationString(histogram.max() * 1000),
+    };
+}
+
+void Benchmark::runOpenLoop(std::vector<double> rates_Hz, const uint32_t timePerRate_s,
+        const uint32_t minimumRepetitions) {
+    assert(timePerRate_s > 0);
+    assert(minimumRepetitions >= 10);
+    // The capacity is taken by the schedule loop, not by measure().
+    (void)minimumRepetitions;
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerRate_ns = static_cast<int64_t>(timePerRate_s) * 1000000000;
+    const bool sweep = rates_Hz.empty();
+    std::cout << "Open loop is running for " << m_testees.size() * m_columns.size()
+        << " subjects:\n";
+
+    Histogram histogram;
+    int64_t testeeIdx = 0;
+    for (auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+            auto& testee = itVec.second[columnIdx];
+            std::string name = itVec.first;
+            if (m_columns.size() > 1) {
+                name += " " + m_columns[columnIdx].name;
+            }
+            std::cout << " [" << testeeIdx++ << "] " << name << "... ";
+            if (!testee.function) {
+                std::cout << "Noop." << std::endl;
+                continue;
+            }
+            std::cout.flush();
+            const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+
+            double capacity_Hz = 0.0;
+            if (sweep) {
+                // Through the per-call timing and recording of the schedule, which
+                // a batch of measure() does not pay.
+                capacity_Hz = runSchedule(testee.function, nullptr, timePerRate_ns, histogram);
+                rates_Hz.clear();
+                for (const double load : { 0.1, 0.25, 0.5, 0.75, 0.9, 0.95, 1.0, 1.1, 1.25, 1.5 }) {
+                    rates_Hz.push_back(load * capacity_Hz);
+                }
+            }
+
+            // | Offered | Achieved | p50 | p90 | p99 | p99.9 | Max |
+            // |--------:|---------:|----:|----:|----:|------:|----:|
+            std::vector<std::vector<std::string>> rows;
+            for (const double rate_Hz : rates_Hz) {
+                assert(rate_Hz > 0.0);
+                const double interval_ns = 1e9 / rate_Hz;
+                const double achieved_Hz = runSchedule(testee.function,
+                    [interval_ns](uint64_t call) -> int64_t {
+                        return static_cast<int64_t>(call * interval_ns);
+                    }, timePerRate_ns, histogram);
+                rows.push_back(makeLatencyRow(rate_Hz, achieved_Hz, histogram));
+                if (sweep && achieved_Hz < 0.95 * rate_Hz) {
+                    rows.back()[1] += " saturated";
+                    break;
+                }
+            }
+            if (sweep) {
+                // For comparison, a closed loop at half of the capacity, corrected.
+                const double rate_Hz = 0.5 * capacity_Hz;
+                const double achieved_Hz = runClosedLoop(testee.function,
+                    std::max(static_cast<int64_t>(1e9 / rate_Hz), INT64_C(1)),
+                    timePerRate_ns, histogram);
+                rows.push_back(makeLatencyRow(rate_Hz, achieved_Hz, histogram));
+                rows.back()[1] += " closed";
+            }
+
+            std::cout << "Done in " << makeDurationString(
+                    (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+                << (m_doNotOptimize ? " " : "  ") << std::endl;
+            std::cout << "\n" << name;
+            if (sweep) {
+                std::cout << ", closed-loop capacity " << makeRateString(capacity_Hz, "");
+            }
+            std::cout << ":\n";
+            printTable({ "Offered", "Achieved", "p50", "p90", "p99", "p99.9", "Max" },
+                rows, "rrrrrrr");
+            std::cout << "\n";
+        }
+    }
+    std::cout << "Open loop finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+Benchmark::Trace::Trace(const std::string& path, const uint32_t recordSize_B)
+        : m_recordSize_B(recordSize_B) {
+    assert(recordSize_B > 0);
+#ifdef __linux__
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    const off_t size_B = lseek(fd, 0, SEEK_END);
+    if (size_B >= static_cast<off_t>(recordSize_B)) {
+        void* const data = mmap(nullptr, static_cast<size_t>(size_B),
+            PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            madvise(data, static_cast<size_t>(size_B), MADV_SEQUENTIAL);
+            m_data = static_cast<const uint8_t*>(data);
+            m_mapped_B = static_cast<size_t>(size_B);
+            m_records = m_mapped_B / recordSize_B;
+        }
+    }
+    close(fd);
+#else
+    std::ifstream file(path, std::ios::binary);
+    m_fallback.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    m_data = m_fallback.data();
+    m_records = m_fallback.size() / recordSize_B;
+#endif // __linux__
+}
+
+Benchmark::Trace::~Trace() {
+    release();
+}
+
+Benchmark::Trace::Trace(Trace&& other) noexcept {
+    *this = std::move(other);
+}
+
+Benchmark::Trace& Benchmark::Trace::operator=(Trace&& other) noexcept {
+    if (this != &other) {
+        release();
+        m_data = other.m_data;
+        m_records = other.m_records;
+        m_cursor = other.m_cursor;
+        m_recordSize_B = other.m_recordSize_B;
+        m_mapped_B = other.m_mapped_B;
+        m_fallback = std::move(other.m_fallback);
+        other.m_data = nullptr;
+        other.m_records = 0;
+        other.m_mapped_B = 0;
+    }
+    return *this;
+}
+
+void Benchmark::Trace::release() noexcept {
+#ifdef __linux__
+    if (m_mapped_B > 0) {
+        munmap(const_cast<uint8_t*>(m_data), m_mapped_B);
+    }
+#endif // __linux__
+    m_data = nullptr;
+    m_records = 0;
+    m_mapped_B = 0;
+    m_fallback.clear();
+}
+
+void Benchmark::addTrace(std::string name, const uint8_t column, Trace& trace,
+        std::function<uint32_t(const uint8_t* record)> testee) {
+    assert(trace);
+    assert(testee);
+    Trace* const source = &trace;
+    add(std::move(name), column, [source, testee](uint32_t) -> uint32_t {
+        return testee(source->next());
+    });
+}
+
+void Benchmark::runTraceReplay(const std::string& name, Trace& trace,
+        const uint32_t timestampOffset_B, std::function<uint32_t(const uint8_t* record)> testee,
+        const double speed, const uint32_t time_s) {
+    assert(trace);
+    assert(timestampOffset_B + sizeof(uint64_t) <= trace.recordSize());
+    assert(testee);
+    assert(speed > 0.0);
+    assert(time_s > 0);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    std::cout << "Trace replay is running for " << trace.records() << " records:\n";
+    std::cout << " [0] " << name << "... ";
+    std::cout.flush();
+
+    const auto timestamp = [&](const size_t idx) -> uint64_t {
+        uint64_t result = 0;
+        const uint8_t* const bytes = trace.record(idx) + timestampOffset_B;
+        for (uint32_t byte = 0; byte < sizeof(result); ++byte) {
+            result |= static_cast<uint64_t>(bytes[byte]) << (byte * 8);
+        }
+        return result;
+    };
+    const size_t records = trace.records();
+    if (records < 2) {
+        std::cout << "Failed, the trace needs at least 2 records." << std::endl;
+        return;
+    }
+    for (size_t idx = 1; idx < records; ++idx) {
+        if (timestamp(idx) < timestamp(idx - 1)) {
+            std::cout << "Failed, the timestamp of record " << idx << " decreases." << std::endl;
+            return;
+        }
+    }
+    const uint64_t first_ns = timestamp(0);
+    const uint64_t span_ns = timestamp(records - 1) - first_ns;
+    if (span_ns == 0) {
+        std::cout << "Failed, the timestamps do not advance." << std::endl;
+        return;
+    }
+    // One more average gap between the last record and the wrapped first one,
+    // runSchedule() does not wait past the budget for a sparse gap.
+    const double period_ns = static_cast<double>(span_ns) * records / (records - 1);
+    const auto schedule_ns = [&](uint64_t call) -> int64_t {
+        const double arrival_ns = static_cast<double>(call / records) * period_ns
+            + static_cast<double>(timestamp(call % records) - first_ns);
+        return static_cast<int64_t>(arrival_ns / speed);
+    };
+    uint64_t replayed = 0;
+    const auto function = [&](uint32_t) -> uint32_t {
+        return testee(trace.record(replayed++));
+    };
+    Histogram histogram;
+    const double achieved_Hz = runSchedule(function, schedule_ns,
+        static_cast<int64_t>(time_s) * 1000000000, histogram);
+    const double offered_Hz = 1e9 * speed * records / period_ns;
+
+    std::cout << "Done in " << makeDurationString(
+            (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000)
+        << (m_doNotOptimize ? " " : "  ") << std::endl;
+    std::cout << "\n" << name << ", speed " << speed << "x:\n";
+    printTable({ "Offered", "Achieved", "p50", "p90", "p99", "p99.9", "Max" },
+        { makeLatencyRow(offered_Hz, achieved_Hz, histogram) }, "rrrrrrr");
+    std::cout << "\nTrace replay finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+std::vector<int64_t> Benchmark::measureLayout(const size_t stackOffset_B,
+        const size_t heapOffset_B, const int64_t timePerLayout_ns,
+        const uint32_t minimumRepetitions,
+        const std::function<void(size_t heapOffset_B)>& relocate) {
+    // Lives until return, so the measurement loop runs below it.
+# ifdef _WIN32
+    volatile uint8_t* const stackPadding = static_cast<uint8_t*>(_alloca(stackOffset_B + 1));
+# else
+    volatile uint8_t* const stackPadding = static_cast<uint8_t*>(alloca(stackOffset_B + 1));
+# endif // _WIN32
+    stackPadding[0] = 0;
+    // Shifts the following allocations of the same size class.
+    std::vector<uint8_t> heapPadding(heapOffset_B + 1);
+    if (relocate) {
+        relocate(heapOffset_B);
+    }
+    std::vector<int64_t> averages_ps;
+    for (auto& itVec : m_testees) {
+        for (auto& testee : itVec.second) {
+            if (!testee.function) {
+                averages_ps.push_back(0);
+                continue;
+            }
+            measure(testee, getSteadyTickStd_ns(), timePerLayout_ns, minimumRepetitions);
+            averages_ps.push_back(std::max(testee.average_ps, INT64_C(1)));
+        }
+    }
+    return averages_ps;
+}
+
+#ifdef __linux__
+std::vector<int64_t> Benchmark::measureLayoutInChild(const size_t stackOffset_B,
+        const size_t heapOffset_B, const size_t environmentPadding_B) {
+    std::vector<std::string> arguments;
+    {
+        std::ifstream cmdline("/proc/self/cmdline", std::ios::binary);
+        std::string argument;
+        while (std::getline(cmdline, argument, '\0')) {
+            arguments.push_back(argument);
+        }
+    }
+    int fds[2] = { -1, -1 };
+    if (arguments.empty() || pipe(fds) != 0) {
+        return {};
+    }
+    std::vector<std::string> environment;
+    for (char** variable = environ; *variable != nullptr; ++variable) {
+        if (std::strncmp(*variable, "ADAPTIVE_BENCHMARK_LAYOUT", 25) != 0) {
+            environment.push_back(*variable);
+        }
+    }
+    environment.push_back("ADAPTIVE_BENCHMARK_LAYOUT=" + std::to_string(fds[1])
+        + " " + std::to_string(stackOffset_B) + " " + std::to_string(heapOffset_B));
+    environment.push_back("ADAPTIVE_BENCHMARK_LAYOUT_PADDING="
+        + std::string(environmentPadding_B, 'x'));
+    std::vector<char*> argv;
+    for (auto& argument : arguments) {
+        argv.push_back(&argument[0]);
+    }
+    argv.push_back(nullptr);
+    std::vector<char*> envp;
+    for (auto& variable : environment) {
+        envp.push_back(&variable[0]);
+    }
+    envp.push_back(nullptr);
+
+    const pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        const int null = open("/dev/null", O_WRONLY);
+        if (null >= 0) {
+            dup2(null, STDOUT_FILENO);
+        }
+        execve("/proc/self/exe", argv.data(), envp.data());
+        _exit(127);
+    }
+    close(fds[1]);
+    std::vector<int64_t> averages_ps;
+    if (pid > 0) {
+        int64_t average_ps = 0;
+        while (read(fds[0], &average_ps, sizeof(average_ps)) == sizeof(average_ps)) {
+            averages_ps.push_back(average_ps);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            averages_ps.clear();
+        }
+    }
+    close(fds[0]);
+    return averages_ps;
+}
+#endif // __linux__
+
+void Benchmark::runLayouts(const uint32_t layouts, const Layout layout,
+        const uint32_t timePerLayout_s, const uint32_t minimumRepetitions,
+        std::function<void(size_t heapOffset_B)> relocate) {
+    assert(layouts > 0);
+    assert(timePerLayout_s > 0);
+    assert(minimumRepetitions >= 10);
+    const int64_t timePerLayout_ns = static_cast<int64_t>(timePerLayout_s) * 1000000000;
+#ifdef __linux__
+    // The child of Layout::Exec: measures the layout of the parent and exits.
+    if (const char* const child = std::getenv("ADAPTIVE_BENCHMARK_LAYOUT")) {
+        int fd = -1;
+        size_t stackOffset_B = 0;
+        size_t heapOffset_B = 0;
+        std::istringstream(child) >> fd >> stackOffset_B >> heapOffset_B;
+        const auto averages_ps = measureLayout(stackOffset_B, heapOffset_B,
+            timePerLayout_ns, minimumRepetitions, relocate);
+        const ssize_t size = static_cast<ssize_t>(averages_ps.size() * sizeof(int64_t));
+        _exit(write(fd, averages_ps.data(), size) == size ? 0 : 1);
+    }
+#else
+    if (layout == Layout::Exec) {
+        std::cout << "Layout::Exec is supported on Linux only, running in process.\n";
+    }
+#endif // __linux__
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    std::cout << "Layouts are running for " << layouts << " subjects:\n";
+
+    std::vector<std::vector<int64_t>> results; // [layout][cell]
+    for (uint32_t layoutIdx = 0; layoutIdx < layouts; ++layoutIdx) {
+        // Within a page, 16-byte alignment of the stack is kept by alloca.
+        const size_t stackOffset_B = m_rng() % 4096;
+        const size_t heapOffset_B = m_rng() % 4096;
+        const size_t environmentPadding_B = m_rng() % 4096;
+        std::cout << " [" << layoutIdx << "] stack +" << stackOffset_B
+            << ", heap +" << heapOffset_B;
+        if (layout == Layout::Exec) {
+            std::cout << ", environment +" << environmentPadding_B;
+        }
+        std::cout << "... ";
+        std::cout.flush();
+        const int64_t benchmarkLayoutBegin_ns = getSteadyTickStd_ns();
+#ifdef __linux__
+        if (layout == Layout::Exec) {
+            results.push_back(measureLayoutInChild(
+                stackOffset_B, heapOffset_B, environmentPadding_B));
+        }
+        else
+#endif // __linux__
+        {
+            results.push_back(measureLayout(stackOffset_B, heapOffset_B,
+                timePerLayout_ns, minimumRepetitions, relocate));
+        }
+        if (results.back().empty()) {
+            std::cout << "Failed." << std::endl;
+            results.pop_back();
+            continue;
+        }
+        std::cout << "Done in " << makeDurationString(
+                (getSteadyTickStd_ns() - benchmarkLayoutBegin_ns) * 1000)
+            << (m_doNotOptimize ? " " : "  ") << std::endl;
+    }
+
+    // | Name | #0 | #1 | ... | Min | Max | Spread % |
+    // |:-----|---:|---:|-----|----:|----:|---------:|
+    std::vector<std::string> header = { "Name" };
+    std::string align = "l";
+    for (size_t layoutIdx = 0; layoutIdx < results.size(); ++layoutIdx) {
+        header.push_back("#" + std::to_string(layoutIdx));
+        align += "r";
+    }
+    header.insert(header.end(), { "Median", "Spread %" });
+    align += "rr";
+    std::vector<std::vector<std::string>> rows;
+    size_t cellIdx = 0;
+    for (const auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx, ++cellIdx) {
+            std::string name = itVec.first;
+            if (m_columns.size() > 1) {
+                name += " " + m_columns[columnIdx].name;
+            }
+            std::vector<std::string> row = { name };
+            std::vector<int64_t> averages_ps;
+            for (const auto& result : results) {
+                if (cellIdx < result.size() && result[cellIdx] > 0) {
+                    averages_ps.push_back(result[cellIdx]);
+                    row.push_back(makeDurationString(result[cellIdx]));
+                }
+                else {
+                    row.push_back("Noop");
+                }
+            }
+            if (averages_ps.empty()) {
+                row.insert(row.end(), { "-", "-" });
+                rows.push_back(std::move(row));
+                continue;
+            }
+            std::sort(averages_ps.begin(), averages_ps.end());
+            const int64_t median_ps = averages_ps[averages_ps.size() / 2];
+            std::ostringstream spread;
+            spread << std::fixed << std::setprecision(1) << 100.0
+                * static_cast<double>(averages_ps.back() - averages_ps.front()) / median_ps;
+            row.push_back(makeDurationString(median_ps));
+            row.push_back(spread.str());
+            rows.push_back(std::move(row));
+        }
+    }
+    std::cout << "\nAverage time by layout:\n";
+    printTable(header, rows, align);
+    std::cout << "\nSpread is (max - min) / median, differences below it are layout noise.\n";
+    std::cout << "\nLayouts finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+void Benchmark::runInstructions(const uint32_t timePerTestee_s,
+        const uint32_t minimumRepetitions) {
+    assert(timePerTestee_s > 0);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerTestee_ns = static_cast<int64_t>(timePerTestee_s) * 1000000000;
+    std::cout << "Instructions benchmark is running for "
+        << m_instructions.size() + 1 << " subjects:\n";
+
+    // Time of one operation = (time of 512 - time of 256) / 256
+    const auto perOp = [&](const InstructionMeta& meta, const uint32_t kernelIdx) -> double {
+        int64_t averages_ps[2] = {};
+        for (uint32_t idx = 0; idx < 2; ++idx) {
+            TesteeMeta testee;
+            testee.function = meta.kernels[kernelIdx + idx];
+            measure(testee, getSteadyTickStd_ns(), timePerTestee_ns, minimumRepetitions);
+            averages_ps[idx] = testee.average_ps;
+        }
+        return std::max(static_cast<double>(averages_ps[1] - averages_ps[0]) / 256.0, 0.0);
+    };
+    InstructionMeta calibration;
+    calibration.name = "add u64";
+    const auto add = [](const uint64_t a, const uint64_t b) -> uint64_t { return a + b; };
+    calibration.kernels[0] = makeChainKernel<256>(add, UINT64_C(1), UINT64_C(1));
+    calibration.kernels[1] = makeChainKernel<512>(add, UINT64_C(1), UINT64_C(1));
+
+    int64_t testeeIdx = 0;
+    const auto begin = [&](const std::string& name) -> int64_t {
+        std::cout << " [" << testeeIdx++ << "] " << name << "... ";
+        std::cout.flush();
+        return getSteadyTickStd_ns();
+    };
+    const auto done = [&](const int64_t benchmarkTesteeBegin_ns) {
+        std::cout << "Done in " << makeDurationString(
+                (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+            << (m_doNotOptimize ? " " : "  ") << std::endl;
+    };
+    int64_t benchmarkTesteeBegin_ns = begin(calibration.name);
+    const double cycle_ps = std::max(perOp(calibration, 0), 1.0);
+    done(benchmarkTesteeBegin_ns);
+
+    // | Name | Latency | Cycles | Throughput | Per cycle |
+    // |:-----|--------:|-------:|-----------:|----------:|
+    // | mul  |   937ps |   3.00 |      312ps |      1.00 |
+    std::vector<std::vector<std::string>> rows;
+    for (const auto& meta : m_instructions) {
+        benchmarkTesteeBegin_ns = begin(meta.name);
+        const double latency_ps = perOp(meta, 0);
+        const double throughput_ps = perOp(meta, 2);
+        done(benchmarkTesteeBegin_ns);
+
+        std::ostringstream cycles;
+        std::ostringstream perCycle;
+        cycles << std::fixed << std::setprecision(2) << latency_ps / cycle_ps;
+        perCycle << std::fixed << std::setprecision(2)
+            << cycle_ps / std::max(throughput_ps, 1.0);
+        rows.push_back({ meta.name,
+            makeDurationString(static_cast<int64_t>(latency_ps + 0.5)), cycles.str(),
+            makeDurationString(static_cast<int64_t>(throughput_ps + 0.5)), perCycle.str() });
+    }
+    std::ostringstream GHz;
+    GHz << std::fixed << std::setprecision(2) << 1000.0 / cycle_ps;
+    std::cout << "\nInstructions (1 cycle = "
+        << makeDurationString(static_cast<int64_t>(cycle_ps + 0.5))
+        << ", " << GHz.str() << " GHz):\n";
+    printTable({ "Name", "Latency", "Cycles", "Throughput", "Per cycle" }, rows, "lrrrr");
+    std::cout << "\nInstructions benchmark finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+}
+
+const std::vector<Benchmark::MemoryLevelProbe>& Benchmark::runMemoryProbe(
+        const uint32_t timePerProbe_s, const uint32_t llcFactor, const uint32_t minimumRepetitions) {
+    assert(timePerProbe_s > 0);
+    assert(llcFactor >= 1);
+    assert(minimumRepetitions >= 10);
+    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
+    m_rng.seed(benchmarkBegin_ns);
+    const int64_t timePerProbe_ns = static_cast<int64_t>(timePerProbe_s) * 1000000000;
+    constexpr uint32_t lineWords = 8; // 64 bytes
+    constexpr uint32_t hopsPerCall = 64;
+    constexpr uint32_t chunkWords = 512; // 4 KiB
+
+    // Each level is probed halfway between the previous level and its own size.
+    const std::vector<CacheLevel> caches = getCacheLevels();
+    m_memoryProbe.clear();
+    uint64_t previousSize_B = 0;
+    for (const auto& cache : caches) {
+        MemoryLevelProbe probe;
+        probe.level = cache.level;
+        probe.size_B = (previousSize_B + cache.size_B) / 2;
+        m_memoryProbe.push_back(probe);
+        previousSize_B = cache.size_B;
+    }
+    MemoryLevelProbe ramProbe;
+    ramProbe.size_B = caches.back().size_B * llcFactor;
+    m_memoryProbe.push_back(ramProbe);
+
+    Buffer storage;
+    uint64_t* data = nullptr;
+    uint64_t lines = 0;
+    // Sattolo's algorithm gives a single cycle through all the lines.
+    const auto makeChain = [&](const uint64_t size_B) {
+        lines = std::max(size_B / (lineWords * sizeof(uint64_t)), UINT64_C(2));
+        storage = Buffer(static_cast<size_t>(lines * lineWords * sizeof(uint64_t)));
+        data = reinterpret_cast<uint64_t*>(storage.data());
+        std::vector<uint32_t> order(static_cast<size_t>(lines));
+        for (uint32_t idx = 0; idx < order.size(); ++idx) {
+            order[idx] = idx;
+        }
+        for (size_t idx = order.size() - 1; idx > 0; --idx) {
+            std::swap(order[idx], order[m_rng() % idx]);
+        }
+        for (size_t idx = 0; idx < order.size(); ++idx) {
+            data[order[idx] * lineWords] = reinterpret_cast<uintptr_t>(
+                &data[order[(idx + 1) % order.size()] * lineWords]);
+        }
+    };
+    // Multiply-shift maps a 32-bit random to a line.
+    const auto randomLine = [&](uint32_t& x) -> uint64_t {
+        x = x * 1664525u + 1013904223u;
+        return ((static_cast<uint64_t>(x) * lines) >> 32) * lineWords;
+    };
+    const auto probe = [&](const char* name, const uint64_t size_B,
+            std::function<uint32_t(uint32_t random)> testee) -> int64_t {
+        std::cout << " " << name << " " << makeSizeString(size_B) << "... ";
+        std::cout.flush();
+        TesteeMeta meta;
+        meta.function = std::move(testee);
+        const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+        measure(meta, benchmarkTesteeBegin_ns, timePerProbe_ns, minimumRepetitions);
+        std::cout << "Done in " << makeDurationString(
+                (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+            << (m_doNotOptimize ? " " : "  ") << std::endl;
+        return std::max(meta.average_ps, INT64_C(1));
+    };
+
+    std::cout << "Memory probe is running for " << m_memoryProbe.size() << " levels:\n";
+    for (auto& level : m_memoryProbe) {
+        makeChain(level.size_B);
+        const uint64_t words = lines * lineWords;
+        const uint64_t* chase = data;
+        uint64_t offset = 0;
+        uint32_t x = m_rng();
+
+        level.latency_ps = probe("Latency", level.size_B, [&](uint32_t) -> uint32_t {
+            const uint64_t* p = chase;
+            for (uint32_t i = 0; i < hopsPerCall; ++i) {
+                p = reinterpret_cast<const uint64_t*>(*p);
+            }
+            chase = p;
+            return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(p));
+        }) / hopsPerCall;
+
+        // A level smaller than a chunk is streamed whole, lines are 8 words.
+        const uint32_t levelChunkWords = static_cast<uint32_t>(
+            std::min<uint64_t>(chunkWords, words));
+        const double chunk_B = static_cast<double>(levelChunkWords * sizeof(uint64_t));
+        level.seqRead_Bps = 1e12 * chunk_B / probe("Seq read", level.size_B,
+                [&](uint32_t) -> uint32_t {
+            if (offset + levelChunkWords > words) {
+                offset = 0;
+            }
+            uint64_t sum = 0;
+            for (uint32_t i = 0; i < levelChunkWords; ++i) {
+                sum += data[offset + i];
+            }
+            offset += levelChunkWords;
+            return static_cast<uint32_t>(sum);
+        });
+        level.seqWrite_Bps = 1e12 * chunk_B / probe("Seq write", level.size_B,
+                [&](uint32_t random) -> uint32_t {
+            if (offset + levelChunkWords > words) {
+                offset = 0;
+            }
+            for (uint32_t i = 0; i < levelChunkWords; ++i) {
+                data[offset + i] = random + i;
+            }
+            offset += levelChunkWords;
+            return 0;
+        });
+        const double lines_B = static_cast<double>(hopsPerCall * lineWords * sizeof(uint64_t));
+        level.rndRead_Bps = 1e12 * lines_B / probe("Rnd read", level.size_B,
+                [&](uint32_t) -> uint32_t {
+            uint64_t sum = 0;
+            for (uint32_t i = 0; i < hopsPerCall; ++i) {
+                sum += data[randomLine(x)];
+            }
+            return static_cast<uint32_t>(sum);
+        });
+        level.rndWrite_Bps = 1e12 * lines_B / probe("Rnd write", level.size_B,
+                [&](uint32_t random) -> uint32_t {
+            for (uint32_t i = 0; i < hopsPerCall; ++i) {
+                data[randomLine(x)] = random;
+            }
+            return 0;
+        });
+#     ifdef ADAPTIVE_BENCHMARK_SSE2
+        level.ntWrite_Bps = 1e12 * chunk_B / probe("NT write", level.size_B,
+                [&](uint32_t random) -> uint32_t {
+            if (offset + levelChunkWords > words) {
+                offset = 0;
+            }
+            const __m128i value = _mm_set1_epi32(static_cast<int>(random));
+            __m128i* const dst = reinterpret_cast<__m128i*>(data + offset);
+            for (uint32_t i = 0; i < levelChunkWords / 2; ++i) {
+                _mm_stream_si128(dst + i, value);
+            }
+            _mm_sfence();
+            offset += levelChunkWords;
+            return 0;
+        });
+#     endif // ADAPTIVE_BENCHMARK_SSE2
+    }
+
+    // Chases start evenly spaced along the cycle.
+    makeChain(ramProbe.size_B);
+    constexpr uint32_t maxChains = 16;
+    std::vector<int64_t> perLoad_ps;
+    for (uint32_t chains = 1; chains <= maxChains; chains *= 2) {
+        const uint64_t* heads[maxChains] = {};
+        const uint64_t* p = data;
+        for (uint64_t hop = 0, chain = 0; chain < chains; ++hop) {
+            if (hop == (lines / chains) * chain) {
+                heads[chain++] = p;
+            }
+            p = reinterpret_cast<const uint64_t*>(*p);
+        }
+        const std::string name = "MLP x" + std::to_string(chains);
+        perLoad_ps.push_back(probe(name.c_str(), ramProbe.size_B, [&](uint32_t) -> uint32_t {
+            for (uint32_t i = 0; i < hopsPerCall / chains; ++i) {
+                for (uint32_t chain = 0; chain < chains; ++chain) {
+                    heads[chain] = reinterpret_cast<const uint64_t*>(*heads[chain]);
+                }
+            }
+            return static_cast<uint32_t>(reinterpret_cast<uintptr_t>(heads[0]));
+        }) / hopsPerCall);
+    }
+    storage = Buffer();
+
+    std::vector<std::vector<std::string>> rows;
+    for (const auto& level : m_memoryProbe) {
+        rows.push_back({
+            level.level == 0 ? std::string("RAM") : "L" + std::to_string(level.level),
+            makeSizeString(level.size_B),
+            makeDurationString(level.latency_ps),
+            makeRateString(level.seqRead_Bps, "B"),
+            makeRateString(level.seqWrite_Bps, "B"),
+            makeRateString(level.rndRead_Bps, "B"),
+            makeRateString(level.rndWrite_Bps, "B"),
+            level.ntWrite_Bps > 0.0 ? makeRateString(level.ntWrite_Bps, "B") : "-"
+        });
+    }
+    std::cout << "\nMemory latency and bandwidth:\n";
+    printTable({ "Level", "Size", "Latency", "Seq read", "Seq write",
+        "Rnd read", "Rnd write", "NT write" }, rows, "lrrrrrrr");
+
+    rows.clear();
+    for (uint32_t idx = 0; idx < perLoad_ps.size(); ++idx) {
+        std::ostringstream parallelism;
+        parallelism << std::fixed << std::setprecision(1)
+            << static_cast<double>(perLoad_ps.front()) / std::max(perLoad_ps[idx], INT64_C(1));
+        rows.push_back({ std::to_string(1 << idx), makeDurationString(perLoad_ps[idx]),
+            parallelism.str() });
+    }
+    std::cout << "\nMemory-level parallelism (RAM " << makeSizeString(ramProbe.size_B) << "):\n";
+    printTable({ "Chains", "Time/load", "Parallelism" }, rows, "rrr");
+    std::cout << "\nMemory probe finished in " << makeDurationString(
+        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+    return m_memoryProbe;
+}
+
+void Benchmark::measureRooflinePeaks(const int64_t timePerProbe_ns,
+        const uint32_t minimumRepetitions) {
+    constexpr uint32_t accumulators = 32;
+    constexpr uint32_t iterations = 64;
+    constexpr double opsPerCall = 2.0 * accumulators * iterations;
+    const auto probe = [&](const char* name, std::function<uint32_t(uint32_t random)> testee) {
+        std::cout << " " << name << "... ";
+        std::cout.flush();
+        TesteeMeta meta;
+        meta.function = std::move(testee);
+        meta.probe = true;
+        const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
+        measure(meta, benchmarkTesteeBegin_ns, timePerProbe_ns, minimumRepetitions);
+        std::cout << "Done in " << makeDurationString(
+                (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1000)
+            << (m_doNotOptimize ? " " : "  ") << std::endl;
+        return std::max(meta.average_ps, INT64_C(1));
+    };
+
+    // Independent multiply-add chains which the compiler is free to vectorize
+    // for the target of this build.
+    if (m_peakFlops == 0.0) {
+        m_peakFlops = 1e12 * opsPerCall / probe("Peak FLOP/s", [](uint32_t random) -> uint32_t {
+            const double m = 1.0 - 1e-9 * (random & 0xFF);
+            const double a = 1e-9 * (random >> 24);
+            double acc[accumulators];
+            for (uint32_t i = 0; i < accumulators; ++i) {
+                acc[i] = static_cast<double>(random + i);
+            }
+            for (uint32_t k = 0; k < iterations; ++k) {
+                for (uint32_t i = 0; i < accumulators; ++i) {
+                    acc[i] = acc[i] * m + a;
+                }
+            }
+            double sum = 0.0;
+            for (uint32_t i = 0; i < accumulators; ++i) {
+                sum += acc[i];
+            }
+            return static_cast<uint32_t>(sum);
+        });
+    }
+    if (m_peakIntOps == 0.0) {
+        m_peakIntOps = 1e12 * opsPerCall / probe("Peak int ops/s", [](uint32_t random) -> uint32_t {
+            const uint32_t m = random | 1;
+            const uint32_t a = random >> 7;
+            uint32_t acc[accumulators];
+            for (uint32_t i = 0; i < accumulators; ++i) {
+                acc[i] = random + i;
+            }
+            for (uint32_t k = 0; k < iterations; ++k) {
+                for (uint32_t i = 0; i < accumulators; ++i) {
+                    acc[i] = acc[i] * m + a;
+                }
+            }
+            uint32_t sum = 0;
+            for (uint32_t i = 0; i < accumulators; ++i) {
+                sum ^= acc[i];
+            }
+            return sum;
+        });
+    }
+    // Sequential read from RAM, taken from the memory probe when it was run.
+    if (m_peakBandwidth_Bps == 0.0) {
+        if (!m_memoryProbe.empty()) {
+            m_peakBandwidth_Bps = m_memoryProbe.back().seqRead_Bps;
+        }
+        else {
+            constexpr uint32_t chunkWords = 512; // 4 KiB
+            std::vector<uint64_t> data(static_cast<size_t>(
+                getCacheLevels().back().size_B * 4 / sizeof(uint64_t)), 1);
+            size_t offset = 0;
+            m_peakBandwidth_Bps = 1e12 * chunkWords * sizeof(uint64_t)
+                    / probe("Peak bytes/s", [&](uint32_t) -> uint32_t {
+                if (offset + chunkWords > data.size()) {
+                    offset = 0;
+                }
+                uint64_t sum = 0;
+                for (uint32_t i = 0; i < chunkWords; ++i) {
+                    sum += data[offset + i];
+                }
+                offset += chunkWords;
+                return static_cast<uint32_t>(sum);
+            });
+        }
+    }
+}
+
+// | Name | Column | Ops/s | Bytes/s | Ops/B | Bound  | Peak % |
+// |:-----|-------:|------:|--------:|------:|:-------|-------:|
+// | name |      0 | 1 G/s |  8 GB/s | 0.125 | memory |   80.0 |
+void Benchmark::printRoofline() {
+    std::vector<std::vector<std::string>> rows;
+    for (const auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+            const auto& testee = itVec.second[columnIdx];
+            if (!testee.function || (testee.opsPerCall <= 0.0 && testee.bytesPerCall <= 0.0)) {
+                continue;
+            }
+            const double calls = 1e12 / std::max(testee.average_ps, INT64_C(1));
+            const double ops = testee.opsPerCall * calls;
+            const double bytes = testee.bytesPerCall * calls;
+            const double peakOps = testee.integerOps ? m_peakIntOps : m_peakFlops;
+            // Attainable = min(peak compute, intensity * peak bandwidth)
+            std::string intensity = "-";
+            bool memoryBound = testee.opsPerCall <= 0.0;
+            double attainable = memoryBound ? m_peakBandwidth_Bps : peakOps;
+            if (testee.opsPerCall > 0.0 && testee.bytesPerCall > 0.0) {
+                const double opsPerByte = testee.opsPerCall / testee.bytesPerCall;
+                std::ostringstream stream;
+                stream << std::setprecision(3) << opsPerByte;
+                intensity = stream.str();
+                memoryBound = opsPerByte * m_peakBandwidth_Bps < peakOps;
+                attainable = memoryBound ? opsPerByte * m_peakBandwidth_Bps : peakOps;
+            }
+            const double achieved = testee.opsPerCall > 0.0 ? ops : bytes;
+            std::ostringstream peak;
+            peak << std::fixed << std::setprecision(1)
+                << 100.0 * achieved / std::max(attainable, 1.0);
+            rows.push_back({
+                itVec.first,
+                std::to_string(columnIdx),
+                testee.opsPerCall > 0.0
+                    ? makeRateString(ops, testee.integerOps ? "ops" : "FLOP") : "-",
+                testee.bytesPerCall > 0.0 ? makeRateString(bytes, "B") : "-",
+                intensity,
+                memoryBound ? "memory" : "compute",
+                peak.str()
+            });
+        }
+    }
+    std::cout << "\nRoofline (peak " << makeRateString(m_peakFlops, "FLOP")
+        << ", " << makeRateString(m_peakIntOps, "ops")
+        << ", " << makeRateString(m_peakBandwidth_Bps, "B") << "):\n";
+    printTable({ "Name", "Column", "Ops/s", "Bytes/s", "Ops/B", "Bound", "Peak %" },
+        rows, "lrrrrlr");
+}
+
+// | Name | Column | Items/s | Bytes/s | probes/op | probes/s |
+// |:-----|-------:|--------:|--------:|----------:|---------:|
+// | name |      0 |   1 G/s |  8 GB/s |      1.50 |  1.5 G/s |
+void Benchmark::printThroughput() {
+    std::vector<std::string> counters;
+    bool hasItems = false;
+    bool hasBytes = false;
+    for (const auto& itVec : m_testees) {
+        for (const auto& testee : itVec.second) {
+            if (!testee.function || testee.calls == 0) {
+                continue;
+            }
+            hasItems |= testee.itemsPerCall > 0.0 || testee.state.m_items > 0;
+            hasBytes |= testee.processedBytesPerCall > 0.0 || testee.state.m_bytes > 0;
+            for (const auto& counter : testee.state.m_counters) {
+                if (std::find(counters.begin(), counters.end(), counter.first) == counters.end()) {
+                    counters.push_back(counter.first);
+                }
+            }
+        }
+    }
+    if (!hasItems && !hasBytes && counters.empty()) {
+        return;
+    }
+    std::vector<std::string> header = { "Name", "Column" };
+    std::string align = "lr";
+    if (hasItems) {
+        header.push_back("Items/s");
+        align += 'r';
+    }
+    if (hasBytes) {
+        header.push_back("Bytes/s");
+        align += 'r';
+    }
+    for (const auto& counter : counters) {
+        header.push_back(counter + "/op");
+        header.push_back(counter + "/s");
+        align += "rr";
+    }
+    std::vector<std::vector<std::string>> rows;
+    for (const auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+            const auto& testee = itVec.second[columnIdx];
+            if (!testee.function || testee.calls == 0) {
+                continue;
+            }
+            const double calls = static_cast<double>(testee.calls);
+            const double callsPerSecond = 1e12 / std::max(testee.average_ps, INT64_C(1));
+            std::vector<std::string> row = { itVec.first, std::to_string(columnIdx) };
+            if (hasItems) {
+                const double items = testee.itemsPerCall + testee.state.m_items / calls;
+                row.push_back(items > 0.0 ? makeRateString(items * callsPerSecond, "") : "-");
+            }
+            if (hasBytes) {
+                const double bytes = testee.processedBytesPerCall + testee.state.m_bytes / calls;
+                row.push_back(bytes > 0.0 ? makeRateString(bytes * callsPerSecond, "B") : "-");
+            }
+            for (const auto& name : counters) {
+                const auto& stateCounters = testee.state.m_counters;
+                const auto counter = std::find_if(stateCounters.begin(), stateCounters.end(),
+                    [&](const std::pair<std::string, double>& it) { return it.first == name; });
+                if (counter == stateCounters.end()) {
+                    row.push_back("-");
+                    row.push_back("-");
+                    continue;
+                }
+                std::ostringstream perOp;
+                perOp << std::setprecision(3) << counter->second / calls;
+                row.push_back(perOp.str());
+                row.push_back(makeRateString(counter->second / calls * callsPerSecond, ""));
+            }
+            rows.push_back(std::move(row));
+        }
+    }
+    std::cout << "\nThroughput:\n";
+    printTable(header, rows, align);
+}
+
+void Benchmark::measure(TesteeMeta& testee, const int64_t testeeBegin_ns,
+        const int64_t timePerTestee_ns, const uint32_t minimumRepetitions) {
+    testee.minimum_ps = INT64_MAX;
+    testee.maximum_ps = 0;
+    testee.average_ps = 0;
+    testee.calls = 0;
+    testee.state = State();
+    State* const previousState = s_state;
+    s_state = &testee.state;
+    // Without the timeline, a probe of the zone overhead would measure its pushes too.
+    Timeline* const previousTimeline = s_timeline;
+    const bool timeline = m_timeline.file.is_open() && !testee.probe;
+    s_timeline = testee.probe ? nullptr : previousTimeline;
+    if (timeline) {
+        s_timeline = &m_timeline;
+        sampleTimelineFrequency();
+    }
+    // A local keeps the sum in a register, unlike a member which the testee may alias.
+    uint32_t doNotOptimize = 0;
+    int64_t sum_ns = 0;
+    testee.partial = false;
+    const int64_t lastTick_ns = testeeBegin_ns + timePerTestee_ns;
+    // The last batch may cross lastTick_ns, the watchdog cuts the overruns.
+    const int64_t watchdogTick_ns = lastTick_ns + timePerTestee_ns / 10;
+    // Rough measurement, in rounds of 1, 2, 4, ... calls while the next round
+    // fits into a tenth of the budget, so a slow testee stops after a few calls.
+    const int64_t roughBudget_ns = timePerTestee_ns / 10;
+    const int64_t roughBegin_ns = getSteadyTick_ns();
+    uint32_t roughCalls = 0;
+    for (uint32_t round = 1; roughCalls < minimumRepetitions; round *= 2) {
+        const uint32_t roundCalls = std::min(round, minimumRepetitions - roughCalls);
+        for (uint32_t i = 0; i < roundCalls; ++i) {
+            const uint32_t random = m_rng();
+            const int64_t begin_ns = getSteadyTick_ns();
+
+            doNotOptimize += testee.function(random);
+
+            const int64_t end_ns = getSteadyTick_ns();
+            const int64_t diff_ns = end_ns - begin_ns;
+            if (diff_ns <= 1) {
+                continue;
+            }
+            sum_ns += diff_ns;
+            testee.minimum_ps = std::min(testee.minimum_ps, diff_ns * 1000);
+            testee.maximum_ps = std::max(testee.maximum_ps, diff_ns * 1000);
+        }
+        roughCalls += roundCalls;
+        const int64_t elapsed_ns = getSteadyTick_ns() - roughBegin_ns;
+        const uint32_t nextCalls = std::min(round * 2, minimumRepetitions - roughCalls);
+        // Fewer calls are enough to calibrate, the main measurement makes up for them.
+        if (elapsed_ns + elapsed_ns / roughCalls * nextCalls > roughBudget_ns
+                && roughCalls < minimumRepetitions) {
+            break;
+        }
+    }
+    testee.average_ps = (sum_ns / roughCalls) * 1000;
+    testee.calls += roughCalls;
+    if (s_timeline) {
+        m_timeline.addPhase("rough", roughBegin_ns, getSteadyTick_ns(), roughCalls);
+        sampleTimelineFrequency();
+    }
+# ifdef DEBUG_ADAPTIVE_BENCHMARK
+    std::cout
+        << "\n min=" << makeDurationString(testee.minimum_ps)
+        << " max=" << makeDurationString(testee.maximum_ps)
+        << " avg=" << makeDurationString(testee.average_ps);
+# endif
+
+    constexpr int64_t minDesiredTime_ps = INT64_C(5000000000); // 5 ms
+    constexpr int64_t minClarifyingTime_ps = INT64_C(500000000000); // 500 ms
+    uint32_t n = 0;
+    if (testee.average_ps < minDesiredTime_ps) {
+        n = minDesiredTime_ps / testee.average_ps;
+        // Up to a quarter of the budget per phase.
+        constexpr uint32_t maxReps = minClarifyingTime_ps / minDesiredTime_ps;
+        const uint32_t reps = static_cast<uint32_t>(std::max<int64_t>(std::min<int64_t>(
+            timePerTestee_ns * 1000 / 4 / minDesiredTime_ps, maxReps), 10));
+        testee.minimum_ps = INT64_MAX;
+        testee.maximum_ps = 0;
+        testee.average_ps = 0;
+        sum_ns = 0;
+        const int64_t clarifyingBegin_ps = getSteadyTick_ns() * 1000;
+        // Clarifying measurement
+        uint32_t executed = 0;
+        for (; executed < reps; ++executed) {
+            if (executed > 0 && getSteadyTickStd_ns() >= watchdogTick_ns) {
+                testee.partial = true;
+                break;
+            }
+            const uint32_t random = m_rng();
+            const int64_t begin_ns = getSteadyTick_ns();
+
+            for (uint32_t j = 0; j < n; ++j) {
+                doNotOptimize += testee.function(random);
+            }
+
+            const int64_t end_ns = getSteadyTick_ns();
+            const int64_t diff_ns = end_ns - begin_ns;
+            if (diff_ns <= 1) {
+                continue;
+            }
+            sum_ns += diff_ns;
+            testee.minimum_ps = std::min(testee.minimum_ps, (diff_ns * 1000) / n);
+            testee.maximum_ps = std::max(testee.maximum_ps, (diff_ns * 1000) / n);
+        }
+        const int64_t clarifyingEnd_ps = getSteadyTick_ns() * 1000;
+        if (s_timeline) {
+            m_timeline.addPhase("clarifying", clarifyingBegin_ps / 1000, clarifyingEnd_ps / 1000,
+                static_cast<uint64_t>(executed) * n);
+            sampleTimelineFrequency();
+        }
+        testee.average_ps = (sum_ns * 1000) / executed;
+        testee.average_ps /= n;
+        testee.calls += static_cast<uint64_t>(executed) * n;
+#     ifdef DEBUG_ADAPTIVE_BENCHMARK
+        std::cout << "\n clarifying="
+            << makeDurationString(clarifyingEnd_ps - clarifyingBegin_ps);
+#     endif
+
+        n = minDesiredTime_ps / testee.average_ps;
+        testee.minimum_ps = INT64_MAX;
+        testee.maximum_ps = 0;
+        testee.average_ps = 0;
+        sum_ns = 0;
+        const int64_t clarifying2Begin_ps = getSteadyTick_ns() * 1000;
+        // Clarifying measurement
+        executed = 0;
+        for (; executed < reps; ++executed) {
+            if (executed > 0 && getSteadyTickStd_ns() >= watchdogTick_ns) {
+                testee.partial = true;
+                break;
+            }
+            const uint32_t random = m_rng();
+            const int64_t begin_ns = getSteadyTick_ns();
+
+            for (uint32_t j = 0; j < n; ++j) {
+                doNotOptimize += testee.function(random);
+            }
+
+            const int64_t end_ns = getSteadyTick_ns();
+            const int64_t diff_ns = end_ns - begin_ns;
+            if (diff_ns <= 1) {
+                continue;
+            }
+            sum_ns += diff_ns;
+            testee.minimum_ps = std::min(testee.minimum_ps, (diff_ns * 1000) / n);
+            testee.maximum_ps = std::max(testee.maximum_ps, (diff_ns * 1000) / n);
+        }
+        const int64_t clarifying2End_ps = getSteadyTick_ns() * 1000;
+        if (s_timeline) {
+            m_timeline.addPhase("clarifying", clarifying2Begin_ps / 1000,
+                clarifying2End_ps / 1000, static_cast<uint64_t>(executed) * n);
+            sampleTimelineFrequency();
+        }
+        testee.average_ps = (sum_ns * 1000) / executed;
+        testee.average_ps /= n;
+        testee.calls += static_cast<uint64_t>(executed) * n;
+#     ifdef DEBUG_ADAPTIVE_BENCHMARK
+        std::cout << "\n clarifying="
+            << makeDurationString(clarifying2End_ps - clarifying2Begin_ps);
+#     endif
+    }
+# ifdef DEBUG_ADAPTIVE_BENCHMARK
+    std::cout
+        << "\n n=" << n
+        << " min=" << makeDurationString(testee.minimum_ps)
+        << " max=" << makeDurationString(testee.maximum_ps)
+        << " avg=" << makeDurationString(testee.average_ps);
+# endif
+
+    const int64_t remainingTime_ns = lastTick_ns - getSteadyTickStd_ns();
+    uint64_t repetitions = 0;
+    if (remainingTime_ns > 0) {
+        repetitions = (remainingTime_ns * 1000) / testee.average_ps;
+        n = minDesiredTime_ps / testee.average_ps;
+        if (n > 0) {
+            repetitions /= n;
+            if (repetitions > 0) {
+                sum_ns = 0;
+            }
+        }
+    }
+
+    if (m_streaming) {
+        m_streaming->reset();
+    }
+    if (m_sampleLog.header && !testee.probe) {
+        startSampleLog(testee);
+    }
+    // Zones count the main measurement only, like the average time.
+    for (auto& zone : testee.state.m_zones) {
+        zone.calls = 0;
+        zone.inclusive_ns = 0;
+        zone.children_ns = 0;
+    }
+    // Main measurement
+    if (testee.mainBegins) {
+        testee.mainBegins();
+    }
+    const uint64_t mainCalls = testee.calls;
+    const int64_t mainBegin_ns = getSteadyTick_ns();
+    if (m_estimator == Estimator::Regression) {
+        measureRegression(testee, lastTick_ns, n);
+    }
+    else if (n == 0) {
+        uint64_t executed = 0;
+        for (; executed < repetitions; ++executed) {
+            // Watchdog, for a testee slowing down.
+            if (getSteadyTickStd_ns() >= watchdogTick_ns) {
+                testee.partial = true;
+                break;
+            }
+            const uint32_t random = m_rng();
+            const int64_t begin_ns = getSteadyTick_ns();
+
+            doNotOptimize += testee.function(random);
+
+            const int64_t end_ns = getSteadyTick_ns();
+            if (m_sampleLog.header && !testee.probe) {
+                logSample(testee, begin_ns, end_ns, 1);
+            }
+            if (s_timeline) {
+                addTimelineBatch(testee, begin_ns, end_ns, 1);
+            }
+            if (m_streaming) {
+                m_streaming->add(static_cast<double>(end_ns - begin_ns) * 1000.0);
+            }
+            const int64_t diff_ns = end_ns - begin_ns;
+            if (diff_ns <= 1) {
+                continue;
+            }
+            sum_ns += diff_ns;
+            testee.minimum_ps = std::min(testee.minimum_ps, diff_ns * 1000);
+            testee.maximum_ps = std::max(testee.maximum_ps, diff_ns * 1000);
+        }
+        testee.average_ps = sum_ns / (roughCalls + executed) * 1000;
+        testee.calls += executed;
+    }
+    else if (repetitions > 0) {
+        uint64_t executed = 0;
+        for (; executed < repetitions; ++executed) {
+            if (getSteadyTickStd_ns() >= watchdogTick_ns) {
+                testee.partial = true;
+                break;
+            }
+            const uint32_t random = m_rng();
+            const int64_t begin_ns = getSteadyTick_ns();
+
+            for (uint32_t j = 0; j < n; ++j) {
+                doNotOptimize += testee.function(random);
+            }
+
+            const int64_t end_ns = getSteadyTick_ns();
+            if (m_sampleLog.header && !testee.probe) {
+                logSample(testee, begin_ns, end_ns, n);
+            }
+            if (s_timeline) {
+                addTimelineBatch(testee, begin_ns, end_ns, n);
+            }
+            if (m_streaming) {
+                m_streaming->add(static_cast<double>(end_ns - begin_ns) * 1000.0 / n);
+            }
+            const int64_t diff_ns = end_ns - begin_ns;
+            if (diff_ns <= 1) {
+                continue;
+            }
+            sum_ns += diff_ns;
+            testee.minimum_ps = std::min(testee.minimum_ps, (diff_ns * 1000) / n);
+            testee.maximum_ps = std::max(testee.maximum_ps, (diff_ns * 1000) / n);
+        }
+        testee.average_ps = (sum_ns * 1000) / std::max(executed, UINT64_C(1));
+        testee.average_ps /= n;
+        testee.calls += executed * n;
+    }
+    if (testee.mainEnds) {
+        testee.mainEnds();
+    }
+# ifdef DEBUG_ADAPTIVE_BENCHMARK
+    std::cout
+        << "\n n=" << n << " r=" << repetitions
+        << " min=" << makeDurationString(testee.minimum_ps)
+        << " max=" << makeDurationString(testee.maximum_ps)
+        << " avg=" << makeDurationString(testee.average_ps) << "\n";
+# endif
+    testee.state.m_zonedCalls = testee.calls - mainCalls;
+    if (testee.calls - mainCalls < minimumRepetitions) {
+        testee.partial = true;
+    }
+    m_doNotOptimize += doNotOptimize;
+    s_state = previousState;
+    s_timeline = previousTimeline;
+    if (timeline) {
+        m_timeline.addPhase("main", mainBegin_ns, getSteadyTick_ns(), testee.calls - mainCalls);
+        sampleTimelineFrequency();
+        testee.timelineDropped = flushTimeline();
+    }
+    if (m_streaming && m_streaming->count() > 0) {
+        // Summarized, so the memory does not grow with the testees.
+        testee.stddev_ps = std::sqrt(m_streaming->variance());
+        for (size_t idx = 0; idx < 3; ++idx) {
+            testee.sketches_ps[idx] = m_streaming->sketch(idx);
+        }
+        testee.median_ps = m_streaming->quantile(0.5);
+        testee.medianCi95_ps = m_streaming->bootstrapCi95(0.5);
+    }
+    if (m_sampleLog.header && !testee.probe) {
+        finishSampleLog(testee);
+    }
+}
+
+// Batches of n/50..n calls in 50 steps, repeated until the time is over.
+// A slow testee gets fewer and smaller steps, so a cycle fits the budget.
+// The least squares fit of the batch time: time = a + b * calls
+//   b - cost of a call, free of the timer and loop overhead
+//   a - fixed overhead of a batch
+void Benchmark::measureRegression(TesteeMeta& testee, const int64_t lastTick_ns,
+        const uint32_t n) {
+    // A cycle of steps is steps * (steps + 1) / 2 * step calls.
+    const double remainingCalls = 1000.0
+        * std::max<int64_t>(lastTick_ns - getSteadyTickStd_ns(), 0)
+        / std::max<int64_t>(testee.average_ps, 1);
+    const uint32_t steps = static_cast<uint32_t>(
+        std::max(std::min(std::sqrt(2.0 * remainingCalls), 50.0), 3.0));
+    const double cycleCalls = steps * (steps + 1) / 2.0;
+    const uint32_t step = std::max(std::min(n / steps,
+        static_cast<uint32_t>(std::min(remainingCalls / cycleCalls, 1e9))), UINT32_C(1));
+    testee.minimum_ps = INT64_MAX;
+    testee.maximum_ps = 0;
+    // Welford's online covariance
+    uint64_t batches = 0;
+    double meanX = 0.0;
+    double meanY = 0.0;
+    double m2X = 0.0;
+    double m2Y = 0.0;
+    double cXY = 0.0;
+    uint32_t doNotOptimize = 0;
+    for (uint32_t k = 1; ; k = k % steps + 1) {
+        // Clamped to the time left, a slow testee would overrun the budget by a cycle.
+        const double leftCalls = 1000.0 * (lastTick_ns - getSteadyTickStd_ns())
+            / std::max<int64_t>(testee.average_ps, 1);
+        const uint32_t calls = static_cast<uint32_t>(
+            std::max(std::min(static_cast<double>(k * step), leftCalls), 1.0));
+        const uint32_t random = m_rng();
+        const int64_t begin_ns = getSteadyTick_ns();
+
+        for (uint32_t j = 0; j < calls; ++j) {
+            doNotOptimize += testee.function(random);
+        }
+
+        const int64_t end_ns = getSteadyTick_ns();
+        if (m_sampleLog.header && !testee.probe) {
+            logSample(testee, begin_ns, end_ns, calls);
+        }
+        if (s_timeline) {
+            addTimelineBatch(testee, begin_ns, end_ns, calls);
+        }
+        if (m_streaming) {
+            m_streaming->add(static_cast<double>(end_ns - begin_ns) * 1000.0 / calls);
+        }
+        const int64_t diff_ns = end_ns - begin_ns;
+        testee.calls += calls;
+        if (diff_ns > 1) {
+            testee.minimum_ps = std::min(testee.minimum_ps, (diff_ns * 1000) / calls);
+            testee.maximum_ps = std::max(testee.maximum_ps, (diff_ns * 1000) / calls);
+        }
+        ++batches;
+        const double x = static_cast<double>(calls);
+        const double y = static_cast<double>(diff_ns) * 1000.0;
+        const double dX = x - meanX;
+        const double dY = y - meanY;
+        meanX += dX / batches;
+        meanY += dY / batches;
+        m2X += dX * (x - meanX);
+        m2Y += dY * (y - meanY);
+        cXY += dX * (y - meanY);
+        if (getSteadyTickStd_ns() >= lastTick_ns) {
+            break;
+        }
+    }
+    m_doNotOptimize += doNotOptimize;
+    if (batches < 3 || m2X <= 0.0) {
+        // Too slow for a fit in the budget, the time per call.
+        testee.partial = true;
+        testee.slope_ps = meanY / meanX;
+        testee.intercept_ps = 0.0;
+        testee.r2 = 0.0;
+        testee.slopeCi95_ps = 0.0;
+        testee.average_ps = static_cast<int64_t>(testee.slope_ps + 0.5);
+        if (testee.minimum_ps == INT64_MAX) {
+            testee.minimum_ps = 0;
+        }
+        return;
+    }
+    testee.slope_ps = cXY / m2X;
+    testee.intercept_ps = meanY - testee.slope_ps * meanX;
+    const double residual = std::max(m2Y - testee.slope_ps * cXY, 0.0);
+    testee.r2 = m2Y > 0.0 ? 1.0 - residual / m2Y : 1.0;
+    testee.slopeCi95_ps = studentT95(batches - 2) * std::sqrt(residual / (batches - 2) / m2X);
+    testee.average_ps = static_cast<int64_t>(std::max(testee.slope_ps, 0.0) + 0.5);
+    if (testee.minimum_ps == INT64_MAX) {
+        testee.minimum_ps = 0;
+    }
+# ifdef DEBUG_ADAPTIVE_BENCHMARK
+    std::cout
+        << "\n step=" << step << " batches=" << batches
+        << " b=" << testee.slope_ps << "ps a=" << testee.intercept_ps
+        << "ps R2=" << testee.r2;
+# endif
+}
+
+void Benchmark::measureBatches(TesteeMeta& testee, const int64_t testeeBegin_ns,
+        const int64_t timePerTestee_ns, const uint32_t n, const uint32_t minimumRepetitions) {
+    testee.minimum_ps = INT64_MAX;
+    testee.maximum_ps = 0;
+    testee.average_ps = 0;
+    testee.calls = 0;
+    testee.partial = false;
+    testee.timelineDropped = 0;
+    testee.state = State();
+    State* const previousState = s_state;
+    s_state = &testee.state;
+    // The same sample log and timeline as the main measurement of measure().
+    Timeline* const previousTimeline = s_timeline;
+    const bool timeline = m_timeline.file.is_open() && !testee.probe;
+    s_timeline = testee.probe ? nullptr : previousTimeline;
+    if (timeline) {
+        s_timeline = &m_timeline;
+        sampleTimelineFrequency();
+    }
+    if (m_sampleLog.header && !testee.probe) {
+        startSampleLog(testee);
+    }
+    const int64_t lastTick_ns = testeeBegin_ns + timePerTestee_ns;
+    const int64_t watchdogTick_ns = lastTick_ns + timePerTestee_ns / 10;
+    constexpr int64_t desiredTime_ns = 5000000; // 5 ms
+    uint32_t batch = std::max(n, UINT32_C(1));
+    uint32_t doNotOptimize = 0;
+    int64_t sum_ns = 0;
+    uint64_t summed = 0;
+    const int64_t mainBegin_ns = getSteadyTick_ns();
+    do {
+        const uint32_t random = m_rng();
+        const int64_t begin_ns = getSteadyTick_ns();
+
+        for (uint32_t j = 0; j < batch; ++j) {
+            doNotOptimize += testee.function(random);
+        }
+
+        const int64_t end_ns = getSteadyTick_ns();
+        if (m_sampleLog.header && !testee.probe) {
+            logSample(testee, begin_ns, end_ns, batch);
+        }
+        if (s_timeline) {
+            addTimelineBatch(testee, begin_ns, end_ns, batch);
+        }
+        const int64_t diff_ns = end_ns - begin_ns;
+        testee.calls += batch;
+        // Watchdog, for a testee slowing down.
+        if (getSteadyTickStd_ns() >= watchdogTick_ns) {
+            testee.partial = true;
+        }
+        if (diff_ns <= 1) {
+            continue;
+        }
+        sum_ns += diff_ns;
+        summed += batch;
+        testee.minimum_ps = std::min(testee.minimum_ps, (diff_ns * 1000) / batch);
+        testee.maximum_ps = std::max(testee.maximum_ps, (diff_ns * 1000) / batch);
+        // Smaller batches for a testee slowing down, so the watchdog can stop it.
+        if (diff_ns > 2 * desiredTime_ns) {
+            batch = static_cast<uint32_t>(std::max<int64_t>(
+                batch * desiredTime_ns / diff_ns, 1));
+        }
+    } while (!testee.partial && getSteadyTickStd_ns() < lastTick_ns);
+    testee.average_ps = summed > 0 ? sum_ns * 1000 / static_cast<int64_t>(summed) : 0;
+    if (testee.minimum_ps == INT64_MAX) {
+        testee.minimum_ps = 0;
+    }
+    if (testee.calls < minimumRepetitions) {
+        testee.partial = true;
+    }
+    testee.state.m_zonedCalls = testee.calls;
+    m_doNotOptimize += doNotOptimize;
+    s_state = previousState;
+    s_timeline = previousTimeline;
+    if (timeline) {
+        m_timeline.addPhase("main", mainBegin_ns, getSteadyTick_ns(), testee.calls);
+        sampleTimelineFrequency();
+        testee.timelineDropped = flushTimeline();
+    }
+    if (m_sampleLog.header && !testee.probe) {
+        finishSampleLog(testee);
+    }
+}
+
+bool Benchmark::setSampleLog(const std::string& path, const uint64_t capacity) {
+    closeSampleLog();
+    if (path.empty()) {
+        return true;
+    }
+    assert(capacity > 0);
+#ifdef __linux__
+    static_assert(sizeof(Sample) == sizeof(SampleLogHeader), "header is the first record");
+    const size_t size_B = static_cast<size_t>((capacity + 1) * sizeof(Sample));
+    m_sampleLog.fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_sampleLog.fd < 0) {
+        return false;
+    }
+    if (ftruncate(m_sampleLog.fd, static_cast<off_t>(size_B)) != 0) {
+        closeSampleLog();
+        return false;
+    }
+    void* const data = mmap(nullptr, size_B, PROT_READ | PROT_WRITE, MAP_SHARED,
+        m_sampleLog.fd, 0);
+    if (data == MAP_FAILED) {
+        closeSampleLog();
+        return false;
+    }
+    m_sampleLog.header = static_cast<SampleLogHeader*>(data);
+    m_sampleLog.header->magic = sampleLogMagic;
+    m_sampleLog.header->sampleSize_B = sizeof(Sample);
+    m_sampleLog.header->samples = 0;
+    m_sampleLog.header->capacity = capacity;
+    std::memset(m_sampleLog.header->reserved, 0, sizeof(m_sampleLog.header->reserved));
+    m_sampleLog.names.open(path + ".names");
+    m_sampleLog.testee = 0;
+    return true;
+#else
+    (void)path;
+    return false;
+#endif // __linux__
+}
+
+void Benchmark::closeSampleLog() noexcept {
+#ifdef __linux__
+    if (m_sampleLog.header) {
+        const uint64_t samples = m_sampleLog.header->samples;
+        munmap(m_sampleLog.header,
+            static_cast<size_t>((m_sampleLog.header->capacity + 1) * sizeof(Sample)));
+        // Drops the unused preallocation.
+        if (ftruncate(m_sampleLog.fd, static_cast<off_t>((samples + 1) * sizeof(Sample))) != 0) {
+            std::cout << "Failed to truncate the sample log.\n";
+        }
+    }
+    if (m_sampleLog.fd >= 0) {
+        close(m_sampleLog.fd);
+    }
+#endif // __linux__
+    m_sampleLog.header = nullptr;
+    m_sampleLog.fd = -1;
+    m_sampleLog.names.close();
+}
+
+void Benchmark::logSample(const TesteeMeta& testee, const int64_t begin_ns,
+        const int64_t end_ns, const uint32_t calls) noexcept {
+    SampleLogHeader& header = *m_sampleLog.header;
+    if (header.samples >= header.capacity) {
+        return;
+    }
+    Sample& sample = reinterpret_cast<Sample*>(&header)[1 + header.samples];
+    sample.begin_ns = begin_ns;
+    sample.duration_ns = end_ns - begin_ns;
+    sample.items = testee.state.m_items - m_sampleLog.items;
+    sample.bytes = testee.state.m_bytes - m_sampleLog.bytes;
+    sample.calls = calls;
+#ifdef __linux__
+    const int cpu = sched_getcpu();
+    sample.cpu = cpu >= 0 ? static_cast<uint16_t>(cpu) : UINT16_MAX;
+#else
+    sample.cpu = UINT16_MAX;
+#endif // __linux__
+    sample.testee = m_sampleLog.testee;
+    m_sampleLog.items = testee.state.m_items;
+    m_sampleLog.bytes = testee.state.m_bytes;
+    const auto& counters = testee.state.m_counters;
+    for (size_t idx = 0; idx < 4; ++idx) {
+        const double counter = idx < counters.size() ? counters[idx].second : 0.0;
+        sample.counters[idx] = counter - m_sampleLog.counters[idx];
+        m_sampleLog.counters[idx] = counter;
+    }
+    sample.cycles = UINT64_MAX;
+    sample.instructions = UINT64_MAX;
+    if (*m_sampleLog.cyclesCounter && *m_sampleLog.instructionsCounter) {
+        const uint64_t cycles = m_sampleLog.cyclesCounter->read();
+        const uint64_t instructions = m_sampleLog.instructionsCounter->read();
+        sample.cycles = cycles - m_sampleLog.cycles;
+        sample.instructions = instructions - m_sampleLog.instructions;
+        m_sampleLog.cycles = cycles;
+        m_sampleLog.instructions = instructions;
+    }
+    ++header.samples;
+}
+
+void Benchmark::startSampleLog(const TesteeMeta& testee) {
+    m_sampleLog.items = testee.state.m_items;
+    m_sampleLog.bytes = testee.state.m_bytes;
+    const auto& counters = testee.state.m_counters;
+    for (size_t idx = 0; idx < 4; ++idx) {
+        m_sampleLog.counters[idx] = idx < counters.size() ? counters[idx].second : 0.0;
+    }
+#ifdef __linux__
+    m_sampleLog.cyclesCounter.reset(
+        new PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES));
+    m_sampleLog.instructionsCounter.reset(
+        new PerfCounter(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS));
+#else
+    m_sampleLog.cyclesCounter.reset(new PerfCounter(0, 0));
+    m_sampleLog.instructionsCounter.reset(new PerfCounter(0, 0));
+#endif // __linux__
+    m_sampleLog.cyclesCounter->start();
+    m_sampleLog.instructionsCounter->start();
+    m_sampleLog.cycles = 0;
+    m_sampleLog.instructions = 0;
+}
+
+void Benchmark::finishSampleLog(const TesteeMeta& testee) {
+    // After the measurement, the counters created during it are named too.
+    m_sampleLog.names << (m_measuredName.empty()
+        ? "#" + std::to_string(m_sampleLog.testee) + "\t" : m_measuredName);
+    const auto& counters = testee.state.m_counters;
+    for (size_t idx = 0; idx < std::min<size_t>(counters.size(), 4); ++idx) {
+        m_sampleLog.names << "\t" << counters[idx].first;
+    }
+    m_sampleLog.names << "\n";
+    m_sampleLog.cyclesCounter.reset();
+    m_sampleLog.instructionsCounter.reset();
+    ++m_sampleLog.testee;
+}
+
+bool Benchmark::setTimeline(const std::string& path, const uint32_t capacity) {
+    closeTimeline();
+    if (path.empty()) {
+        return true;
+    }
+    assert(capacity > 2 * Timeline::phaseSlots);
+    m_timeline.file.open(path);
+    if (!m_timeline.file) {
+        return false;
+    }
+    m_timeline.file << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+    m_timeline.events.reserve(capacity);
+    m_timeline.capacity = capacity;
+    m_timeline.origin_ns = getSteadyTick_ns();
+    m_timeline.testee = 0;
+    m_timeline.totalDropped = 0;
+    m_timeline.empty = true;
+    return true;
+}
+
+void Benchmark::closeTimeline() {
+    if (!m_timeline.file.is_open()) {
+        return;
+    }
+    m_timeline.file << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    m_timeline.file.close();
+#ifdef __linux__
+    if (m_timeline.frequencyFd >= 0) {
+        close(m_timeline.frequencyFd);
+    }
+#endif // __linux__
+    m_timeline.frequencyFd = -1;
+    m_timeline.frequencyCpu = -1;
+    if (m_timeline.totalDropped > 0) {
+        std::cout << "Timeline dropped " << m_timeline.totalDropped << " events, capacity "
+            << m_timeline.capacity << ".\n";
+        m_timeline.totalDropped = 0;
+    }
+    m_timeline.events.clear();
+    m_timeline.events.shrink_to_fit();
+}
+
+void Benchmark::addTimelineBatch(const TesteeMeta& testee, const int64_t begin_ns,
+        const int64_t end_ns, const uint32_t calls) noexcept {
+    // A batch twice as slow as the fastest call was likely interrupted.
+    const bool disturbed = testee.minimum_ps != INT64_MAX
+        && (end_ns - begin_ns) * 1000 / calls > 2 * testee.minimum_ps;
+    m_timeline.add(disturbed ? "disturbed" : "batch", 'X', begin_ns, end_ns, calls);
+    // Every 100 ms, between the batches.
+    if (end_ns >= m_timeline.nextFrequency_ns) {
+        sampleTimelineFrequency();
+    }
+}
+
+void Benchmark::sampleTimelineFrequency() noexcept {
+    const int64_t begin_ns = getSteadyTick_ns();
+    m_timeline.nextFrequency_ns = begin_ns + 100000000;
+    const uint64_t frequency_kHz = getCpuFrequency_kHz();
+    if (frequency_kHz > 0) {
+        m_timeline.add("CPU frequency", 'C', begin_ns, begin_ns, frequency_kHz);
+    }
+}
+
+uint64_t Benchmark::getCpuFrequency_kHz() noexcept {
+#ifdef __linux__
+    const int cpu = sched_getcpu();
+    if (cpu < 0) {
+        return 0;
+    }
+    // Reopened only when the thread moves, a sample between the batches is one pread.
+    if (cpu != m_timeline.frequencyCpu) {
+        if (m_timeline.frequencyFd >= 0) {
+            close(m_timeline.frequencyFd);
+        }
+        const std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu)
+            + "/cpufreq/scaling_cur_freq";
+        m_timeline.frequencyFd = open(path.c_str(), O_RDONLY);
+        m_timeline.frequencyCpu = cpu;
+    }
+    char text[32];
+    const ssize_t size_B = m_timeline.frequencyFd >= 0
+        ? pread(m_timeline.frequencyFd, text, sizeof(text), 0) : -1;
+    uint64_t frequency_kHz = 0;
+    for (ssize_t idx = 0; idx < size_B && text[idx] >= '0' && text[idx] <= '9'; ++idx) {
+        frequency_kHz = frequency_kHz * 10 + static_cast<uint64_t>(text[idx] - '0');
+    }
+    return frequency_kHz;
+#else
+    return 0;
+#endif // __linux__
+}
+
+uint64_t Benchmark::flushTimeline() {
+    // One track per measured testee.
+    auto& file = m_timeline.file;
+    const uint32_t tid = m_timeline.testee++;
+    std::string name = m_measuredName.empty() ? "#" + std::to_string(tid) : m_measuredName;
+    std::replace(name.begin(), name.end(), '\t', ' ');
+    // JSON string, the names of zones are user literals too.
+    const auto writeEscaped = [&file](const char* text) {
+        for (; *text != '\0'; ++text) {
+            if (*text == '"' || *text == '\\') {
+                file << '\\';
+            }
+            if (static_cast<unsigned char>(*text) >= 0x20) {
+                file << *text;
+            }
+        }
+    };
+    file << (m_timeline.empty ? "\n" : ",\n")
+        << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+        << ",\"args\":{\"name\":\"";
+    writeEscaped(name.c_str());
+    file << "\"}},\n"
+        << "{\"name\":\"thread_sort_index\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid
+        << ",\"args\":{\"sort_index\":" << tid << "}}";
+    m_timeline.empty = false;
+    for (const auto& event : m_timeline.events) {
+        // Microseconds
+        file << ",\n{\"name\":\"";
+        writeEscaped(event.name);
+        file << "\",\"ph\":\"" << event.phase
+            << "\",\"ts\":" << (event.begin_ns - m_timeline.origin_ns) / 1000.0
+            << ",\"pid\":1,\"tid\":" << tid;
+        if (event.phase == 'C') {
+            file << ",\"args\":{\"MHz\":" << event.value / 1000.0 << "}}";
+        }
+        else {
+            file << ",\"dur\":" << event.duration_ns / 1000.0;
+            if (event.value > 0) {
+                file << ",\"args\":{\"calls\":" << event.value << "}";
+            }
+            file << "}";
+        }
+    }
+    const uint64_t dropped = m_timeline.dropped;
+    file.flush();
+    m_timeline.events.clear();
+    m_timeline.totalDropped += dropped;
+    m_timeline.dropped = 0;
+    return dropped;
+}
+
+bool Benchmark::printSampleLog(const std::string& path) {
+    Trace log(path, sizeof(Sample));
+    if (!log) {
+        return false;
+    }
+    SampleLogHeader header;
+    std::memcpy(&header, log.record(0), sizeof(header));
+    if (header.magic != sampleLogMagic || header.sampleSize_B != sizeof(Sample)) {
+        return false;
+    }
+    // name, column, counters...
+    std::vector<std::vector<std::string>> names;
+    {
+        std::ifstream file(path + ".names");
+        std::string line;
+        while (std::getline(file, line)) {
+            names.emplace_back();
+            std::istringstream fields(line);
+            std::string field;
+            while (std::getline(fields, field, '\t')) {
+                names.back().push_back(field);
+            }
+            names.back().resize(std::max<size_t>(names.back().size(), 2));
+        }
+    }
+    struct Statistics {
+        uint64_t batches = 0;
+        uint64_t calls = 0;
+        int64_t sum_ns = 0;
+        int64_t minimum_ps = INT64_MAX;
+        int64_t maximum_ps = 0;
+        uint64_t items = 0;
+        uint64_t bytes = 0;
+        double counters[4] = {};
+        uint64_t cycles = 0;
+        uint64_t instructions = 0;
+        bool hasPerf = true;
+    };
+    std::vector<Statistics> testees;
+    std::vector<uint16_t> cpus;
+    const uint64_t samples = std::min<uint64_t>(header.samples, log.records() - 1);
+    for (uint64_t idx = 1; idx <= samples; ++idx) {
+        Sample sample;
+        std::memcpy(&sample, log.record(idx), sizeof(sample));
+        if (sample.testee >= testees.size()) {
+            testees.resize(sample.testee + 1);
+        }
+        auto& statistics = testees[sample.testee];
+        ++statistics.batches;
+        statistics.calls += sample.calls;
+        statistics.sum_ns += sample.duration_ns;
+        const int64_t perCall_ps = sample.duration_ns * 1000 / std::max(sample.calls, 1u);
+        statistics.minimum_ps = std::min(statistics.minimum_ps, perCall_ps);
+        statistics.maximum_ps = std::max(statistics.maximum_ps, perCall_ps);
+        statistics.items += sample.items;
+        statistics.bytes += sample.bytes;
+        for (size_t counterIdx = 0; counterIdx < 4; ++counterIdx) {
+            statistics.counters[counterIdx] += sample.counters[counterIdx];
+        }
+        statistics.hasPerf &= sample.cycles != UINT64_MAX;
+        statistics.cycles += sample.cycles;
+        statistics.instructions += sample.instructions;
+        if (std::find(cpus.begin(), cpus.end(), sample.cpu) == cpus.end()) {
+            cpus.push_back(sample.cpu);
+        }
+    }
+
+    // The same tables as run(), the rows and columns in the order of measurement.
+    const auto nameOf = [&](const size_t testeeIdx) -> std::vector<std::string> {
+        return testeeIdx < names.size() ? names[testeeIdx]
+            : std::vector<std::string>{ "#" + std::to_string(testeeIdx), "" };
+    };
+    Benchmark replay;
+    std::vector<std::string> columns;
+    for (size_t testeeIdx = 0; testeeIdx < testees.size(); ++testeeIdx) {
+        const std::string column = nameOf(testeeIdx)[1];
+        if (testees[testeeIdx].batches > 0
+                && std::find(columns.begin(), columns.end(), column) == columns.end()) {
+            columns.push_back(column);
+        }
+    }
+    replay.m_columns.resize(std::max<size_t>(columns.size(), 1));
+    for (size_t columnIdx = 0; columnIdx < columns.size(); ++columnIdx) {
+        if (!columns[columnIdx].empty()) {
+            replay.setColumnName(static_cast<uint8_t>(columnIdx), columns[columnIdx]);
+        }
+    }
+    for (size_t testeeIdx = 0; testeeIdx < testees.size(); ++testeeIdx) {
+        const auto& statistics = testees[testeeIdx];
+        if (statistics.batches == 0) {
+            continue;
+        }
+        const std::vector<std::string> name = nameOf(testeeIdx);
+        const size_t columnIdx = std::find(columns.begin(), columns.end(), name[1])
+            - columns.begin();
+        auto& testee = replay.getRow(name[0]).at(columnIdx);
+        // Not Noop
+        testee.function = [](uint32_t random) -> uint32_t {
+            return random;
+        };
+        testee.calls = statistics.calls;
+        testee.minimum_ps = statistics.minimum_ps;
+        testee.maximum_ps = statistics.maximum_ps;
+        testee.average_ps = statistics.sum_ns * 1000 / static_cast<int64_t>(statistics.calls);
+        testee.state.m_items = statistics.items;
+        testee.state.m_bytes = statistics.bytes;
+        for (size_t counterIdx = 0; counterIdx < 4 && counterIdx + 2 < name.size();
+                ++counterIdx) {
+            testee.state.counter(name[counterIdx + 2]) += statistics.counters[counterIdx];
+        }
+        if (statistics.hasPerf) {
+            testee.state.counter("cycles") += static_cast<double>(statistics.cycles);
+            testee.state.counter("instructions") += static_cast<double>(statistics.instructions);
+        }
+        replay.addToColumn(columnIdx, testee);
+    }
+    std::cout << "Sample log " << path << ", " << samples << " of " << header.capacity
+        << " samples on " << cpus.size() << " CPUs:\n";
+    replay.printTimes();
+    replay.printThroughput();
+    return true;
+}
+
+double Benchmark::studentT95(const uint64_t degreesOfFreedom) {
+    static const double table[] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (degreesOfFreedom == 0) {
+        return INFINITY;
+    }
+    if (degreesOfFreedom <= sizeof(table) / sizeof(table[0])) {
+        return table[degreesOfFreedom - 1];
+    }
+    return degreesOfFreedom <= 120 ? 2.0 : 1.96;
+}
+
+// | Name | Column | Per call | CI95 | Overhead |   R2   |
+// |:-----|-------:|---------:|-----:|---------:|-------:|
+// | name |      0 |    835ps |  2ps |   25ns   | 0.9999 |
+void Benchmark::printRegression() {
+    const auto signedDuration = [](const double duration_ps) -> std::string {
+        const int64_t rounded_ps = static_cast<int64_t>(std::abs(duration_ps) + 0.5);
+        return (duration_ps < 0.0 && rounded_ps > 0 ? "-" : "") + makeDurationString(rounded_ps);
+    };
+    std::vector<std::vector<std::string>> rows;
+    for (const auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+            const auto& testee = itVec.second[columnIdx];
+            if (!testee.function || testee.calls == 0) {
+                continue;
+            }
+            std::ostringstream r2;
+            r2 << std::fixed << std::setprecision(4) << testee.r2;
+            rows.push_back({
+                itVec.first,
+                std::to_string(columnIdx),
+                signedDuration(testee.slope_ps),
+                signedDuration(testee.slopeCi95_ps),
+                signedDuration(testee.intercept_ps),
+                r2.str()
+            });
+        }
+    }
+    std::cout << "\nRegression time = overhead + calls * per call:\n";
+    printTable({ "Name", "Column", "Per call", "CI95", "Overhead", "R2" }, rows, "lrrrrr");
+}
+
+void Benchmark::setStreamingStatistics(const uint32_t reservoirSize) {
+    if (reservoirSize == 0) {
+        m_streaming.reset();
+        return;
+    }
+    m_streaming.reset(new StreamingStatistics(reservoirSize));
+}
+
+void Benchmark::printStreamingStatistics() {
+    std::vector<std::vector<std::string>> rows;
+    for (const auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+            const auto& testee = itVec.second[columnIdx];
+            if (!testee.function || testee.median_ps <= 0.0) {
+                continue;
+            }
+            const auto duration = [](const double duration_ps) -> std::string {
+                return makeDurationString(static_cast<int64_t>(duration_ps + 0.5));
+            };
+            std::ostringstream cv;
+            cv << std::fixed << std::setprecision(2)
+                << (testee.average_ps > 0 ? 100.0 * testee.stddev_ps / testee.average_ps : 0.0);
+            rows.push_back({
+                itVec.first,
+                m_columns[columnIdx].name,
+                duration(testee.stddev_ps),
+                cv.str(),
+                duration(testee.median_ps),
+                duration(testee.medianCi95_ps.first) + " .. "
+                    + duration(testee.medianCi95_ps.second),
+                duration(testee.sketches_ps[0]),
+                duration(testee.sketches_ps[1]),
+                duration(testee.sketches_ps[2]),
+            });
+        }
+    }
+    std::cout << "\nStreaming statistics of the batches:\n";
+    printTable({ "Name", "Column", "Stddev", "CV %", "Median", "Median CI95",
+        "P2 p50", "P2 p90", "P2 p99" }, rows, "llrrrrrrr");
+}
+
+Benchmark::StreamingStatistics::StreamingStatistics(const uint32_t reservoirSize,
+        std::vector<double> sketchedQuantiles)
+        : m_reservoirSize(reservoirSize) {
+    assert(reservoirSize > 0);
+    m_reservoir.reserve(reservoirSize);
+    for (const double quantile : sketchedQuantiles) {
+        assert(quantile > 0.0 && quantile < 1.0);
+        m_sketches.emplace_back();
+        m_sketches.back().quantile = quantile;
+    }
+    reset();
+}
+
+void Benchmark::StreamingStatistics::reset() noexcept {
+    m_count = 0;
+    m_mean = 0.0;
+    m_m2 = 0.0;
+    m_reservoir.clear();
+    m_rng.seed(static_cast<uint32_t>(getSteadyTickStd_ns()));
+    for (auto& sketch : m_sketches) {
+        const double p = sketch.quantile;
+        const double desired[5] = { 1.0, 1.0 + 2.0 * p, 1.0 + 4.0 * p, 3.0 + 2.0 * p, 5.0 };
+        for (uint32_t idx = 0; idx < 5; ++idx) {
+            sketch.heights[idx] = 0.0;
+            sketch.positions[idx] = idx + 1.0;
+            sketch.desired[idx] = desired[idx];
+        }
+    }
+}
+
+void Benchmark::StreamingStatistics::add(const double value) noexcept {
+    ++m_count;
+    const double delta = value - m_mean;
+    m_mean += delta / m_count;
+    m_m2 += delta * (value - m_mean);
+    // Algorithm R
+    if (m_reservoir.size() < m_reservoirSize) {
+        m_reservoir.push_back(static_cast<float>(value));
+    }
+    else {
+        const uint64_t idx = ((static_cast<uint64_t>(m_rng()) << 32) | m_rng()) % m_count;
+        if (idx < m_reservoirSize) {
+            m_reservoir[static_cast<size_t>(idx)] = static_cast<float>(value);
+        }
+    }
+    for (auto& sketch : m_sketches) {
+        sketch.add(value, m_count);
+    }
+}
+
+void Benchmark::StreamingStatistics::P2::add(const double value, const uint64_t count) noexcept {
+    if (count <= 5) {
+        heights[count - 1] = value;
+        if (count == 5) {
+            std::sort(heights, heights + 5);
+        }
+        return;
+    }
+    uint32_t cell = 0;
+    if (value < heights[0]) {
+        heights[0] = value;
+    }
+    else if (value >= heights[4]) {
+        heights[4] = value;
+        cell = 3;
+    }
+    else {
+        while (value >= heights[cell + 1]) {
+            ++cell;
+        }
+    }
+    for (uint32_t idx = cell + 1; idx < 5; ++idx) {
+        positions[idx] += 1.0;
+    }
+    const double increments[5] = { 0.0, quantile / 2.0, quantile, (1.0 + quantile) / 2.0, 1.0 };
+    for (uint32_t idx = 0; idx < 5; ++idx) {
+        desired[idx] += increments[idx];
+    }
+    for (uint32_t idx = 1; idx < 4; ++idx) {
+        const double d = desired[idx] - positions[idx];
+        if ((d >= 1.0 && positions[idx + 1] - positions[idx] > 1.0)
+                || (d <= -1.0 && positions[idx - 1] - positions[idx] < -1.0)) {
+            const double sign = d >= 0.0 ? 1.0 : -1.0;
+            // Piecewise-parabolic prediction, linear if it leaves the neighbours.
+            const double parabolic = heights[idx] + sign / (positions[idx + 1] - positions[idx - 1])
+                * ((positions[idx] - positions[idx - 1] + sign)
+                    * (heights[idx + 1] - heights[idx]) / (positions[idx + 1] - positions[idx])
+                + (positions[idx + 1] - positions[idx] - sign)
+                    * (heights[idx] - heights[idx - 1]) / (positions[idx] - positions[idx - 1]));
+            if (heights[idx - 1] < parabolic && parabolic < heights[idx + 1]) {
+                heights[idx] = parabolic;
+            }
+            else {
+                const uint32_t neighbour = sign > 0.0 ? idx + 1 : idx - 1;
+                heights[idx] += sign * (heights[neighbour] - heights[idx])
+                    / (positions[neighbour] - positions[idx]);
+            }
+            positions[idx] += sign;
+        }
+    }
+}
+
+double Benchmark::StreamingStatistics::quantile(const double quantile) const {
+    assert(quantile >= 0.0 && quantile <= 1.0);
+    if (m_reservoir.empty()) {
+        return 0.0;
+    }
+    std::vector<float> sorted(m_reservoir);
+    const size_t idx = static_cast<size_t>(quantile * (sorted.size() - 1) + 0.5);
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    return sorted[idx];
+}
+
+double Benchmark::StreamingStatistics::sketch(const size_t idx) const noexcept {
+    assert(idx < m_sketches.size());
+    const auto& sketch = m_sketches[idx];
+    if (m_count >= 5) {
+        return sketch.heights[2];
+    }
+    // Too few values for the markers, the nearest rank of what there is.
+    std::vector<double> values(sketch.heights, sketch.heights + m_count);
+    std::sort(values.begin(), values.end());
+    return values.empty() ? 0.0
+        : values[static_cast<size_t>(sketch.quantile * (values.size() - 1) + 0.5)];
+}
+
+std::pair<double, double> Benchmark::StreamingStatistics::bootstrapCi95(
+        const double quantile, const uint32_t resamples) const {
+    assert(quantile >= 0.0 && quantile <= 1.0);
+    assert(resamples >= 40);
+    if (m_reservoir.empty()) {
+        return { 0.0, 0.0 };
+    }
+    lcg32 rng(static_cast<uint32_t>(m_count));
+    const size_t size = m_reservoir.size();
+    const size_t rank = static_cast<size_t>(quantile * (size - 1) + 0.5);
+    std::vector<float> resample(size);
+    std::vector<double> estimates(resamples);
+    for (uint32_t resampleIdx = 0; resampleIdx < resamples; ++resampleIdx) {
+        for (auto& value : resample) {
+            value = m_reservoir[rng() % size];
+        }
+        std::nth_element(resample.begin(), resample.begin() + rank, resample.end());
+        estimates[resampleIdx] = resample[rank];
+    }
+    std::sort(estimates.begin(), estimates.end());
+    return { estimates[static_cast<size_t>(0.025 * (resamples - 1) + 0.5)],
+        estimates[static_cast<size_t>(0.975 * (resamples - 1) + 0.5)] };
+}
+
+double& Benchmark::State::counter(const std::string& name) {
+    for (auto& it : m_counters) {
+        if (it.first == name) {
+            return it.second;
+        }
+    }
+    m_counters.emplace_back(name, 0.0);
+    return m_counters.back().second;
+}
+
+Benchmark::Histogram::Histogram() noexcept {
+    reset();
+}
+
+void Benchmark::Histogram::record(const uint64_t value, const uint64_t count) noexcept {
+    add(m_counts[toIndex(value)], count);
+    add(m_count, count);
+    if (value < m_min.load(std::memory_order_relaxed)) {
+        m_min.store(value, std::memory_order_relaxed);
+    }
+    if (value > m_max.load(std::memory_order_relaxed)) {
+        m_max.store(value, std::memory_order_relaxed);
+    }
+}
+
+void Benchmark::Histogram::recordCorrected(const uint64_t value,
+        const uint64_t expectedInterval) noexcept {
+    record(value);
+    if (expectedInterval == 0) {
+        return;
+    }
+    for (uint64_t missed = value - std::min(value, expectedInterval);
+            missed >= expectedInterval; missed -= expectedInterval) {
+        record(missed);
+    }
+}
+
+void Benchmark::Histogram::merge(const Histogram& other) noexcept {
+    uint64_t count = 0;
+    for (uint32_t idx = 0; idx < buckets; ++idx) {
+        const uint64_t bucket = other.m_counts[idx].load(std::memory_order_relaxed);
+        add(m_counts[idx], bucket);
+        count += bucket;
+    }
+    add(m_count, count);
+    m_min.store(std::min(min(), other.min()), std::memory_order_relaxed);
+    m_max.store(std::max(max(), other.max()), std::memory_order_relaxed);
+}
+
+void Benchmark::Histogram::subtract(const Histogram& older) noexcept {
+    uint64_t count = 0;
+    uint32_t lowest = buckets;
+    uint32_t highest = 0;
+    for (uint32_t idx = 0; idx < buckets; ++idx) {
+        const uint64_t bucket = m_counts[idx].load(std::memory_order_relaxed)
+            - std::min(m_counts[idx].load(std::memory_order_relaxed),
+                older.m_counts[idx].load(std::memory_order_relaxed));
+        m_counts[idx].store(bucket, std::memory_order_relaxed);
+        count += bucket;
+        if (bucket > 0) {
+            lowest = std::min(lowest, idx);
+            highest = idx;
+        }
+    }
+    m_count.store(count, std::memory_order_relaxed);
+    // Within the precision, the extremes of the difference are unknown.
+    m_min.store(count > 0 ? toHighestValue(lowest) : UINT64_MAX, std::memory_order_relaxed);
+    m_max.store(count > 0 ? toHighestValue(highest) : 0, std::memory_order_relaxed);
+}
+
+Benchmark::LatencyRecorder::LatencyRecorder(const uint32_t period_ms,
+        std::function<void(const Snapshot&)> onSnapshot)
+        : m_id([]() {
+            static std::atomic<uint64_t> ids(1);
+            return ids.fetch_add(1);
+        }()) {
+    m_collected_ns = getSteadyTick_ns();
+    {
+        Registry& recorders = registry();
+        std::lock_guard<std::mutex> lock(recorders.mutex);
+        recorders.recorders.push_back(this);
+    }
+    if (period_ms == 0) {
+        return;
+    }
+    m_collector = std::thread([this, period_ms, onSnapshot]() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (!m_wakeup.wait_for(lock, std::chrono::milliseconds(period_ms),
+                [this]() { return m_stop; })) {
+            lock.unlock();
+            const Snapshot snapshot = collect();
+            if (onSnapshot) {
+                onSnapshot(snapshot);
+            }
+            lock.lock();
+        }
+    });
+}
+
+Benchmark::LatencyRecorder::~LatencyRecorder() {
+    {
+        Registry& recorders = registry();
+        std::lock_guard<std::mutex> lock(recorders.mutex);
+        recorders.recorders.erase(std::find(
+            recorders.recorders.begin(), recorders.recorders.end(), this));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeup.notify_all();
+    if (m_collector.joinable()) {
+        m_collector.join();
+    }
+}
+
+Benchmark::LatencyRecorder::Registry& Benchmark::LatencyRecorder::registry() {
+    static Registry recorders;
+    return recorders;
+}
+
+Benchmark::Histogram& Benchmark::LatencyRecorder::threadHistogram() {
+    // One cached recorder per thread, the ids are not reused unlike addresses.
+    struct Cache {
+        uint64_t id = 0;
+        Histogram* histogram = nullptr;
+    };
+    // The histograms of the thread, handed back to the recorders alive at its exit.
+    struct Owner {
+        std::vector<Cache> caches;
+        ~Owner() {
+            Registry& recorders = registry();
+            std::lock_guard<std::mutex> lock(recorders.mutex);
+            for (const auto& cache : caches) {
+                for (LatencyRecorder* const recorder : recorders.recorders) {
+                    if (recorder->m_id == cache.id) {
+                        recorder->release(*cache.histogram);
+                        break;
+                    }
+                }
+            }
+        }
+    };
+    static thread_local Cache cache;
+    if (cache.id == m_id) {
+        return *cache.histogram;
+    }
+    static thread_local Owner owner;
+    for (const auto& other : owner.caches) {
+        if (other.id == m_id) {
+            cache = other;
+            return *cache.histogram;
+        }
     }
-    vec->resize(m_columns.size());
-    auto& meta = vec->at(column);
-    meta.function  = std::move(testee);
+    Registry& recorders = registry();
+    std::lock_guard<std::mutex> registryLock(recorders.mutex);
+    // Drops the recorders destroyed since, so the caches do not grow with them.
+    owner.caches.erase(std::remove_if(owner.caches.begin(), owner.caches.end(),
+        [&recorders](const Cache& other) {
+            return std::find_if(recorders.recorders.begin(), recorders.recorders.end(),
+                [&other](const LatencyRecorder* recorder) {
+                    return recorder->m_id == other.id;
+                }) == recorders.recorders.end();
+        }), owner.caches.end());
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Cache added;
+    added.id = m_id;
+    if (!m_free.empty()) {
+        added.histogram = m_free.back();
+        m_free.pop_back();
+    }
+    else {
+        m_threads.emplace_back();
+        added.histogram = &m_threads.back();
+    }
+    owner.caches.push_back(added);
+    cache = added;
+    return *cache.histogram;
 }
 
-void Benchmark::run(const uint32_t timePerTestee_s, const uint32_t minimumRepetitions) {
-    assert(timePerTestee_s > 0);
-    assert(minimumRepetitions >= 10);
-    const int64_t benchmarkBegin_ns = getSteadyTickStd_ns();
-    std::cout << "Benchmark is running for "
-        << m_testees.size() * m_columns.size() << " subjects:\n";
-    lcg32 rng;
-    rng.seed(benchmarkBegin_ns);
-    const int64_t timePerTestee_ns = static_cast<int64_t>(timePerTestee_s) * 1000000000;
-    const int64_t totalTime_ns = timePerTestee_ns * m_testees.size();
+void Benchmark::LatencyRecorder::release(Histogram& histogram) {
+    // Under m_mutex, collect() sees the counts either in the thread or retired.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_retired.merge(histogram);
+    histogram.reset();
+    m_free.push_back(&histogram);
+}
 
-    int64_t testeeIdx = 0;
-    uint32_t doNotOptimize = 0;
-    for (auto& itVec : m_testees) {
-        uint8_t columnIdx = 0;
-        for (auto& testee : itVec.second) {
-            const int64_t benchmarkTesteeBegin_ns = getSteadyTickStd_ns();
-            std::cout << " [" << testeeIdx++ << "] " << itVec.first << "... ";
-            if (!testee.function) {
-                std::cout << "Noop." << std::endl;
-                continue;
-            }
-            std::cout.flush();
+void Benchmark::LatencyRecorder::record(const uint64_t duration_ns) noexcept {
+    threadHistogram().record(duration_ns);
+}
 
-            testee.minimum_ps = INT64_MAX;
-            testee.maximum_ps = 0;
-            testee.average_ps = 0;
-            int64_t sum_ns = 0;
-            // Rough measurement
-            for (uint32_t i = 0; i < minimumRepetitions; ++i) {
-                const uint32_t random = rng();
-                const int64_t begin_ns = getSteadyTick_ns();
+Benchmark::LatencyRecorder::Snapshot Benchmark::LatencyRecorder::collect() {
+    // The histograms of the threads only grow, the writers are not stopped.
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_interval.reset();
+    for (const auto& histogram : m_threads) {
+        m_interval.merge(histogram);
+    }
+    m_interval.merge(m_retired);
+    const int64_t now_ns = getSteadyTick_ns();
+    Snapshot snapshot;
+    snapshot.interval_ns = now_ns - m_collected_ns;
+    m_collected_ns = now_ns;
+    // Keeps the merged total for the next interval.
+    m_interval.subtract(m_total);
+    m_total.merge(m_interval);
+    snapshot.count = m_interval.count();
+    snapshot.p50_ns = m_interval.percentile(50.0);
+    snapshot.p90_ns = m_interval.percentile(90.0);
+    snapshot.p99_ns = m_interval.percentile(99.0);
+    snapshot.p999_ns = m_interval.percentile(99.9);
+    snapshot.max_ns = m_interval.max();
+    m_snapshot = snapshot;
+    return snapshot;
+}
 
-                doNotOptimize += testee.function(random);
+Benchmark::LatencyRecorder::Snapshot Benchmark::LatencyRecorder::snapshot() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_snapshot;
+}
 
-                const int64_t end_ns = getSteadyTick_ns();
-                const int64_t diff_ns = end_ns - begin_ns;
-                if (diff_ns <= 1) {
-                    continue;
-                }
-                sum_ns += diff_ns;
-                testee.minimum_ps = std::min(testee.minimum_ps, diff_ns * 1000);
-                testee.maximum_ps = std::max(testee.maximum_ps, diff_ns * 1000);
-            }
-            testee.average_ps = (sum_ns / minimumRepetitions) * 1000;
-#         ifdef DEBUG_ADAPTIVE_BENCHMARK
-            std::cout
-                << "\n min=" << makeDurationString(testee.minimum_ps)
-                << " max=" << makeDurationString(testee.maximum_ps)
-                << " avg=" << makeDurationString(testee.average_ps);
-#         endif
-
-            constexpr int64_t minDesiredTime_ps = INT64_C(5000000000); // 5 ms
-            constexpr int64_t minClarifyingTime_ps = INT64_C(500000000000); // 500 ms
-            uint32_t n = 0;
-            if (testee.average_ps < minDesiredTime_ps) {
-                n = minDesiredTime_ps / testee.average_ps;
-                constexpr uint32_t reps = minClarifyingTime_ps / minDesiredTime_ps;
-                testee.minimum_ps = INT64_MAX;
-                testee.maximum_ps = 0;
-                testee.average_ps = 0;
-                sum_ns = 0;
-                const int64_t clarifyingBegin_ps = getSteadyTick_ns() * 1000;
-                // Clarifying measurement
-                for (uint32_t i = 0; i < reps; ++i) {
-                    const uint32_t random = rng();
-                    const int64_t begin_ns = getSteadyTick_ns();
-
-                    for (uint32_t j = 0; j < n; ++j) {
-                        doNotOptimize += testee.function(random);
-                    }
+std::string Benchmark::LatencyRecorder::Snapshot::toString() const {
+    return makeRateString(interval_ns > 0 ? 1e9 * count / interval_ns : 0.0, "")
+        + ", p50 " + makeDurationString(static_cast<int64_t>(p50_ns) * 1000)
+        + ", p90 " + makeDurationString(static_cast<int64_t>(p90_ns) * 1000)
+        + ", p99 " + makeDurationString(static_cast<int64_t>(p99_ns) * 1000)
+        + ", p99.9 " + makeDurationString(static_cast<int64_t>(p999_ns) * 1000)
+        + ", max " + makeDurationString(static_cast<int64_t>(max_ns) * 1000);
+}
 
-                    const int64_t end_ns = getSteadyTick_ns();
-                    const int64_t diff_ns = end_ns - begin_ns;
-                    if (diff_ns <= 1) {
-                        continue;
-                    }
-                    sum_ns += diff_ns;
-                    testee.minimum_ps = std::min(testee.minimum_ps, (diff_ns * 1000) / n);
-                    testee.maximum_ps = std::max(testee.maximum_ps, (diff_ns * 1000) / n);
-                }
-                const int64_t clarifyingEnd_ps = getSteadyTick_ns() * 1000;
-                testee.average_ps = (sum_ns * 1000) / reps;
-                testee.average_ps /= n;
-#             ifdef DEBUG_ADAPTIVE_BENCHMARK
-                std::cout << "\n clarifying="
-                    << makeDurationString(clarifyingEnd_ps - clarifyingBegin_ps);
-#             endif
-
-                n = minDesiredTime_ps / testee.average_ps;
-                testee.minimum_ps = INT64_MAX;
-                testee.maximum_ps = 0;
-                testee.average_ps = 0;
-                sum_ns = 0;
-                const int64_t clarifying2Begin_ps = getSteadyTick_ns() * 1000;
-                // Clarifying measurement
-                for (uint32_t i = 0; i < reps; ++i) {
-                    const uint32_t random = rng();
-                    const int64_t begin_ns = getSteadyTick_ns();
-
-                    for (uint32_t j = 0; j < n; ++j) {
-                        doNotOptimize += testee.function(random);
-                    }
+void Benchmark::Histogram::reset() noexcept {
+    for (auto& counter : m_counts) {
+        counter.store(0, std::memory_order_relaxed);
+    }
+    m_count.store(0, std::memory_order_relaxed);
+    m_min.store(UINT64_MAX, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
 
-                    const int64_t end_ns = getSteadyTick_ns();
-                    const int64_t diff_ns = end_ns - begin_ns;
-                    if (diff_ns <= 1) {
-                        continue;
-                    }
-                    sum_ns += diff_ns;
-                    testee.minimum_ps = std::min(testee.minimum_ps, (diff_ns * 1000) / n);
-                    testee.maximum_ps = std::max(testee.maximum_ps, (diff_ns * 1000) / n);
-                }
-                const int64_t clarifying2End_ps = getSteadyTick_ns() * 1000;
-                testee.average_ps = (sum_ns * 1000) / reps;
-                testee.average_ps /= n;
-#             ifdef DEBUG_ADAPTIVE_BENCHMARK
-                std::cout << "\n clarifying="
-                    << makeDurationString(clarifying2End_ps - clarifying2Begin_ps);
-#             endif
-            }
-#         ifdef DEBUG_ADAPTIVE_BENCHMARK
-            std::cout
-                << "\n n=" << n
-                << " min=" << makeDurationString(testee.minimum_ps)
-                << " max=" << makeDurationString(testee.maximum_ps)
-                << " avg=" << makeDurationString(testee.average_ps);
-#         endif
-
-            const int64_t lastTick_ns = benchmarkTesteeBegin_ns + timePerTestee_ns;
-            const int64_t remainingTime_ns = lastTick_ns - getSteadyTickStd_ns();
-            uint64_t repetitions = 0;
-            if (remainingTime_ns > 0) {
-                repetitions = (remainingTime_ns * 1000) / testee.average_ps;
-                n = minDesiredTime_ps / testee.average_ps;
-                if (n > 0) {
-                    repetitions /= n;
-                    if (repetitions > 0) {
-                        sum_ns = 0;
-                    }
-                }
-            }
+uint64_t Benchmark::Histogram::count() const noexcept {
+    return m_count.load(std::memory_order_relaxed);
+}
 
-            // Main measurement
-            if (n == 0) {
-                for (uint64_t i = 0; i < repetitions; ++i) {
-                    const uint32_t random = rng();
-                    const int64_t begin_ns = getSteadyTick_ns();
+uint64_t Benchmark::Histogram::min() const noexcept {
+    return m_min.load(std::memory_order_relaxed);
+}
 
-                    doNotOptimize += testee.function(random);
+uint64_t Benchmark::Histogram::max() const noexcept {
+    return m_max.load(std::memory_order_relaxed);
+}
 
-                    const int64_t end_ns = getSteadyTick_ns();
-                    const int64_t diff_ns = end_ns - begin_ns;
-                    if (diff_ns <= 1) {
-                        continue;
-                    }
-                    sum_ns += diff_ns;
-                    testee.minimum_ps = std::min(testee.minimum_ps, diff_ns * 1000);
-                    testee.maximum_ps = std::max(testee.maximum_ps, diff_ns * 1000);
-                }
-                testee.average_ps = sum_ns / (minimumRepetitions + repetitions) * 1000;
-            }
-            else if (repetitions > 0) {
-                for (uint64_t i = 0; i < repetitions; ++i) {
-                    const uint32_t random = rng();
-                    const int64_t begin_ns = getSteadyTick_ns();
+uint64_t Benchmark::Histogram::percentile(const double percentile) const noexcept {
+    assert(percentile >= 0.0 && percentile <= 100.0);
+    // The buckets rather than m_count, to be consistent with a concurrent writer.
+    uint64_t total = 0;
+    for (const auto& counter : m_counts) {
+        total += counter.load(std::memory_order_relaxed);
+    }
+    if (total == 0) {
+        return 0;
+    }
+    const uint64_t target = std::max(static_cast<uint64_t>(
+        std::ceil(percentile / 100.0 * static_cast<double>(total))), UINT64_C(1));
+    uint64_t count = 0;
+    for (uint32_t idx = 0; idx < buckets; ++idx) {
+        count += m_counts[idx].load(std::memory_order_relaxed);
+        if (count >= target) {
+            return std::min(toHighestValue(idx), max());
+        }
+    }
+    return max();
+}
 
-                    for (uint32_t j = 0; j < n; ++j) {
-                        doNotOptimize += testee.function(random);
-                    }
+uint32_t Benchmark::Histogram::toIndex(const uint64_t value) noexcept {
+    if (value < subBuckets) {
+        return static_cast<uint32_t>(value);
+    }
+#if defined(__GNUC__) || defined(__clang__)
+    const uint32_t msb = 63 - static_cast<uint32_t>(__builtin_clzll(value));
+#else
+    uint32_t msb = 0;
+    for (uint64_t rest = value; rest > 1; rest >>= 1) {
+        ++msb;
+    }
+#endif
+    // [2^msb, 2^(msb + 1)) is split into `subBuckets` buckets.
+    const uint32_t shift = msb - subBucketBits;
+    return (shift + 1) * subBuckets + static_cast<uint32_t>((value >> shift) - subBuckets);
+}
 
-                    const int64_t end_ns = getSteadyTick_ns();
-                    const int64_t diff_ns = end_ns - begin_ns;
-                    if (diff_ns <= 1) {
-                        continue;
-                    }
-                    sum_ns += diff_ns;
-                    testee.minimum_ps = std::min(testee.minimum_ps, (diff_ns * 1000) / n);
-                    testee.maximum_ps = std::max(testee.maximum_ps, (diff_ns * 1000) / n);
-                }
-                testee.average_ps = (sum_ns * 1000) / repetitions;
-                testee.average_ps /= n;
-            }
-#         ifdef DEBUG_ADAPTIVE_BENCHMARK
-            std::cout
-                << "\n n=" << n << " r=" << repetitions
-                << " min=" << makeDurationString(testee.minimum_ps)
-                << " max=" << makeDurationString(testee.maximum_ps)
-                << " avg=" << makeDurationString(testee.average_ps) << "\n";
-#         endif
+uint64_t Benchmark::Histogram::toHighestValue(const uint32_t index) noexcept {
+    if (index < subBuckets) {
+        return index;
+    }
+    const uint32_t shift = index / subBuckets - 1;
+    const uint64_t lowest = static_cast<uint64_t>(subBuckets + index % subBuckets) << shift;
+    return lowest + ((UINT64_C(1) << shift) - 1);
+}
 
-            std::cout << "Done in " << makeDurationString(
-                    (getSteadyTickStd_ns() - benchmarkTesteeBegin_ns) * 1009)
-                << (doNotOptimize ? " " : "  ") << std::endl;
-
-            auto& column = m_columns[columnIdx++];
-            column.minTime_ps = std::min(testee.minimum_ps, column.minTime_ps);
-            column.minTimeStrLength = std::max(column.minTimeStrLength,
-                static_cast<uint32_t>(makeDurationString(testee.minimum_ps).size()));
-            column.maxTime_ps = std::min(testee.maximum_ps, column.maxTime_ps);
-            column.maxTimeStrLength = std::max(column.maxTimeStrLength,
-                static_cast<uint32_t>(makeDurationString(testee.maximum_ps).size()));
-            column.avgTime_ps = std::min(testee.average_ps, column.avgTime_ps);
-            column.avgTimeStrLength = std::max(column.avgTimeStrLength,
-                static_cast<uint32_t>(makeDurationString(testee.average_ps).size()));
-        }
-    }
-    
-    // | Name | Time | % | Time | % |
-    // |:-----|-----:|--:|-----:|--:|
-    // | name | 123s |4.5| 678s |9.0|
-    const auto print = [&](const uint8_t mode) { // 0 - min, 1 - max, 2 - avg
-        std::cout << "| " << std::setw(m_maxNameLength) << std::setfill(' ') << std::left
-            << "Name" << " |";
-        for (size_t columnIdx = 0; columnIdx < m_columns.size(); ++columnIdx) {
-            const auto& column = m_columns[columnIdx];
-            uint32_t timeStrLength = 0;
-            switch (mode) {
-            case 0: timeStrLength = column.minTimeStrLength; break;
-            case 1: timeStrLength = column.maxTimeStrLength; break;
-            case 2: timeStrLength = column.avgTimeStrLength; break;
-            } //                                                                     100.0
-            std::cout << std::setw(timeStrLength + 1) << std::right << "Time" << " |   %   |";
+Benchmark::Zone::Zone(const char* name)
+        : m_state(state()) {
+    const uint32_t parent = m_state.m_openZones.empty()
+        ? UINT32_MAX : m_state.m_openZones.back();
+    auto& zones = m_state.m_zones;
+    m_idx = 0;
+    while (m_idx < zones.size()
+            && (zones[m_idx].name != name || zones[m_idx].parent != parent)) {
+        ++m_idx;
+    }
+    if (m_idx == zones.size()) {
+        zones.emplace_back();
+        zones.back().name = name;
+        zones.back().parent = parent;
+    }
+    m_state.m_openZones.push_back(m_idx);
+    m_begin_ns = getSteadyTick_ns();
+}
+
+Benchmark::Zone::~Zone() {
+    const int64_t end_ns = getSteadyTick_ns();
+    const int64_t duration_ns = end_ns - m_begin_ns;
+    if (s_timeline) {
+        s_timeline->addZone(m_state.m_zones[m_idx].name, m_begin_ns, end_ns);
+    }
+    auto& zone = m_state.m_zones[m_idx];
+    ++zone.calls;
+    zone.inclusive_ns += duration_ns;
+    m_state.m_openZones.pop_back();
+    if (zone.parent != UINT32_MAX) {
+        m_state.m_zones[zone.parent].children_ns += duration_ns;
+    }
+}
+
+int64_t Benchmark::measureZoneOverhead(const int64_t timePerTestee_ns,
+        const uint32_t minimumRepetitions) {
+    bool hasZones = false;
+    for (const auto& itVec : m_testees) {
+        for (const auto& testee : itVec.second) {
+            hasZones |= !testee.state.m_zones.empty();
         }
-        std::cout << "\n|:" << std::setw(m_maxNameLength + 1) << std::setfill('-') << "-"
-            << "|";
-        for (size_t columnIdx = 0; columnIdx < m_columns.size(); ++columnIdx) {
-            const auto& column = m_columns[columnIdx];
-            uint32_t timeStrLength = 0;
-            switch (mode) {
-            case 0: timeStrLength = column.minTimeStrLength; break;
-            case 1: timeStrLength = column.maxTimeStrLength; break;
-            case 2: timeStrLength = column.avgTimeStrLength; break;
-            } //                                                                  100.0
-            std::cout << std::setw(timeStrLength + 1) << std::right << "-" << ":|------:|";
+    }
+    if (!hasZones) {
+        return 0;
+    }
+    constexpr uint32_t zones = 16;
+    TesteeMeta empty;
+    empty.function = [](uint32_t random) -> uint32_t {
+        return random;
+    };
+    empty.probe = true;
+    TesteeMeta zoned;
+    zoned.function = [](uint32_t random) -> uint32_t {
+        for (uint32_t idx = 0; idx < zones; ++idx) {
+            ADAPTIVE_BENCHMARK_ZONE("overhead");
         }
-        std::cout << "\n";
-        for (const auto& itVec : m_testees) {
-            std::cout << "| " << std::setw(m_maxNameLength) << std::setfill(' ')
-                << std::left << itVec.first << " |";
-            for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
-                const auto& testee = itVec.second[columnIdx];
-                const auto& column = m_columns[columnIdx];
-                int64_t testeeTime_ps = 0;
-                int64_t time_ps = 0;
-                uint32_t timeStrLength = 0;
-                switch (mode) {
-                case 0:
-                    testeeTime_ps = testee.minimum_ps;
-                    time_ps = column.minTime_ps;
-                    timeStrLength = column.minTimeStrLength;
-                    break;
-                case 1:
-                    testeeTime_ps = testee.maximum_ps;
-                    time_ps = column.maxTime_ps;
-                    timeStrLength = column.maxTimeStrLength;
-                    break;
-                case 2:
-                    testeeTime_ps = testee.average_ps;
-                    time_ps = column.avgTime_ps;
-                    timeStrLength = column.avgTimeStrLength;
-                    break;
+        return random;
+    };
+    zoned.probe = true;
+    const int64_t timePerProbe_ns = std::min(timePerTestee_ns, INT64_C(1000000000));
+    measure(empty, getSteadyTickStd_ns(), timePerProbe_ns, minimumRepetitions);
+    measure(zoned, getSteadyTickStd_ns(), timePerProbe_ns, minimumRepetitions);
+    return std::max((zoned.average_ps - empty.average_ps) / zones, INT64_C(1));
+}
+
+void Benchmark::printZones(const int64_t overhead_ps) {
+    // | Name | Column | Zone | Calls | Inclusive | Exclusive | % |
+    // |:-----|:-------|:-----|------:|----------:|----------:|--:|
+    std::vector<std::vector<std::string>> rows;
+    for (const auto& itVec : m_testees) {
+        for (size_t columnIdx = 0; columnIdx < itVec.second.size(); ++columnIdx) {
+            const auto& testee = itVec.second[columnIdx];
+            const auto& zones = testee.state.m_zones;
+            if (zones.empty() || testee.state.m_zonedCalls == 0) {
+                continue;
+            }
+            const double calls = static_cast<double>(testee.state.m_zonedCalls);
+            // Depth-first, children after their parent.
+            std::vector<std::pair<uint32_t, uint32_t>> stack; // zone, depth
+            for (uint32_t idx = static_cast<uint32_t>(zones.size()); idx-- > 0;) {
+                if (zones[idx].parent == UINT32_MAX) {
+                    stack.emplace_back(idx, 0);
+                }
+            }
+            while (!stack.empty()) {
+                const uint32_t idx = stack.back().first;
+                const uint32_t depth = stack.back().second;
+                stack.pop_back();
+                const auto& zone = zones[idx];
+                const double inclusive_ps = zone.inclusive_ns * 1000.0 / calls;
+                const double exclusive_ps = (zone.inclusive_ns - zone.children_ns) * 1000.0 / calls;
+                std::ostringstream share;
+                share << std::fixed << std::setprecision(1)
+                    << (testee.average_ps > 0 ? 100.0 * inclusive_ps / testee.average_ps : 0.0);
+                std::ostringstream callsPerCall;
+                callsPerCall << std::setprecision(3) << zone.calls / calls;
+                rows.push_back({
+                    itVec.first,
+                    m_columns[columnIdx].name,
+                    std::string(depth * 2, ' ') + zone.name,
+                    callsPerCall.str(),
+                    makeDurationString(static_cast<int64_t>(inclusive_ps + 0.5)),
+                    makeDurationString(static_cast<int64_t>(std::max(exclusive_ps, 0.0) + 0.5)),
+                    share.str(),
+                });
+                for (uint32_t child = static_cast<uint32_t>(zones.size()); child-- > 0;) {
+                    if (zones[child].parent == idx) {
+                        stack.emplace_back(child, depth + 1);
+                    }
                 }
-                const float perc = 0.1f * static_cast<float>(
-                    (testeeTime_ps * 1000) / std::max(time_ps, INT64_C(1))
-                );
-                std::cout << std::setw(timeStrLength + 1) << std::right
-                    << makeDurationString(testeeTime_ps)
-                    << " | " << std::setw(5) << perc << " |";
             }
-            std::cout << "\n";
         }
-    };
-    std::cout << "\nMinimum time:\n";
-    print(0);
-    std::cout << "\nMaximum time:\n";
-    print(1);
-    std::cout << "\nAverage time:\n";
-    print(2);
-    std::cout << "\nBenchmark finished in " << makeDurationString(
-        (getSteadyTickStd_ns() - benchmarkBegin_ns) * 1000) << std::endl;
+    }
+    std::cout << "\nZones per call (overhead " << makeDurationString(overhead_ps)
+        << " per zone, more with many distinct zones):\n";
+    printTable({ "Name", "Column", "Zone", "Calls", "Inclusive", "Exclusive", "%" },
+        rows, "lllrrrr");
+}
+
+Benchmark::State& Benchmark::state() noexcept {
+    // Outside of a measurement the reports go nowhere.
+    static thread_local State dummy;
+    return s_state != nullptr ? *s_state : dummy;
 }
 
 int64_t Benchmark::getSteadyTickStd_ns() noexcept {
@@ -465,6 +5534,280 @@ int64_t Benchmark::getSteadyTick_ns() noexcept {
 #endif // _WIN32
 }
 
+bool Benchmark::isSupported(const Isa isa) noexcept {
+    if (isa == Isa::Generic) {
+        return true;
+    }
+#ifdef ADAPTIVE_BENCHMARK_X86
+    // EAX, EBX, ECX, EDX
+    uint32_t leaf1[4] = {};
+    uint32_t leaf7[4] = {};
+# ifdef _MSC_VER
+    int regs[4] = {};
+    __cpuid(regs, 0);
+    const uint32_t maxLeaf = static_cast<uint32_t>(regs[0]);
+    __cpuidex(reinterpret_cast<int*>(leaf1), 1, 0);
+    if (maxLeaf >= 7) {
+        __cpuidex(reinterpret_cast<int*>(leaf7), 7, 0);
+    }
+# else
+    const uint32_t maxLeaf = __get_cpuid_max(0, nullptr);
+    __cpuid_count(1, 0, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+    if (maxLeaf >= 7) {
+        __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+    }
+# endif
+    const auto bit = [](const uint32_t reg, const uint32_t idx) -> bool {
+        return ((reg >> idx) & 1) != 0;
+    };
+    // The OS saves the SSE and AVX, and the AVX-512 registers.
+    uint64_t xcr0 = 0;
+    if (bit(leaf1[2], 27)) { // OSXSAVE
+# ifdef _MSC_VER
+        xcr0 = _xgetbv(0);
+# else
+        uint32_t eax = 0;
+        uint32_t edx = 0;
+        asm volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+        xcr0 = (static_cast<uint64_t>(edx) << 32) | eax;
+# endif
+    }
+    const bool avxState = (xcr0 & 0x06) == 0x06;
+    const bool avx512State = (xcr0 & 0xE6) == 0xE6;
+
+    const bool sse42 = bit(leaf1[2], 20) && bit(leaf1[2], 23); // SSE4.2, POPCNT
+    const bool avx2 = sse42 && avxState && bit(leaf1[2], 28) // AVX
+        && bit(leaf1[2], 12) && bit(leaf7[1], 5) // FMA, AVX2
+        && bit(leaf7[1], 3) && bit(leaf7[1], 8); // BMI1, BMI2
+    const bool avx512 = avx2 && avx512State
+        && bit(leaf7[1], 16) && bit(leaf7[1], 17) // F, DQ
+        && bit(leaf7[1], 30) && bit(leaf7[1], 31); // BW, VL
+    switch (isa) {
+    case Isa::SSE42: return sse42;
+    case Isa::AVX2: return avx2;
+    case Isa::AVX512: return avx512;
+    default: break;
+    }
+#endif // ADAPTIVE_BENCHMARK_X86
+    return false;
+}
+
+const char* Benchmark::toString(const Isa isa) noexcept {
+    switch (isa) {
+    case Isa::Generic: return "Generic";
+    case Isa::SSE42: return "SSE4.2";
+    case Isa::AVX2: return "AVX2";
+    case Isa::AVX512: return "AVX-512";
+    default: return "?";
+    }
+}
+
+std::vector<Benchmark::CacheLevel> Benchmark::getCacheLevels() {
+    std::vector<CacheLevel> result;
+#ifdef __linux__
+    for (uint32_t idx = 0; ; ++idx) {
+        const std::string path = "/sys/devices/system/cpu/cpu0/cache/index"
+            + std::to_string(idx) + "/";
+        std::ifstream typeFile(path + "type");
+        if (!typeFile) {
+            break;
+        }
+        std::string type;
+        typeFile >> type;
+        if (type == "Instruction") {
+            continue;
+        }
+        uint32_t level = 0;
+        std::ifstream(path + "level") >> level;
+        std::string size;
+        std::ifstream(path + "size") >> size;
+        uint32_t lineSize_B = 0;
+        std::ifstream(path + "coherency_line_size") >> lineSize_B;
+
+        CacheLevel cache;
+        cache.level = static_cast<uint8_t>(level);
+        char* suffix = nullptr;
+        cache.size_B = std::strtoull(size.c_str(), &suffix, 10);
+        switch (*suffix) {
+        case 'K': cache.size_B <<= 10; break;
+        case 'M': cache.size_B <<= 20; break;
+        case 'G': cache.size_B <<= 30; break;
+        }
+        if (lineSize_B > 0) {
+            cache.lineSize_B = lineSize_B;
+        }
+        if (cache.level == 0 || cache.size_B == 0) {
+            continue;
+        }
+        result.push_back(cache);
+    }
+    std::sort(result.begin(), result.end(), [](const CacheLevel& a, const CacheLevel& b) {
+        return a.level < b.level;
+    });
+#endif // __linux__
+    if (result.empty()) {
+        result.resize(3);
+        result[0].level = 1;
+        result[0].size_B = UINT64_C(32) << 10;
+        result[1].level = 2;
+        result[1].size_B = UINT64_C(256) << 10;
+        result[2].level = 3;
+        result[2].size_B = UINT64_C(8) << 20;
+    }
+    return result;
+}
+
+std::vector<uint32_t> Benchmark::getNumaNodes() {
+    std::vector<uint32_t> result;
+#ifdef __linux__
+    // 0-1,3
+    std::string online;
+    std::ifstream("/sys/devices/system/node/online") >> online;
+    std::istringstream ranges(online);
+    std::string range;
+    while (std::getline(ranges, range, ',')) {
+        char* end = nullptr;
+        const uint32_t first = static_cast<uint32_t>(std::strtoul(range.c_str(), &end, 10));
+        const uint32_t last = *end == '-'
+            ? static_cast<uint32_t>(std::strtoul(end + 1, nullptr, 10)) : first;
+        for (uint32_t node = first; node <= last && end != range.c_str(); ++node) {
+            result.push_back(node);
+        }
+    }
+#endif // __linux__
+    if (result.empty()) {
+        result.push_back(0);
+    }
+    return result;
+}
+
+Benchmark::Buffer::Buffer(const size_t size_B, const Backing backing, const int32_t numaNode) {
+    assert(size_B > 0);
+#ifdef __linux__
+    constexpr size_t hugePage_B = 2 << 20;
+    const size_t page_B = backing == Backing::Normal
+        ? static_cast<size_t>(sysconf(_SC_PAGESIZE)) : hugePage_B;
+    const size_t rounded_B = (size_B + page_B - 1) / page_B * page_B;
+    m_allocated_B = rounded_B;
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+    if (backing == Backing::HugeTLB) {
+#     ifdef MAP_HUGETLB
+        flags |= MAP_HUGETLB;
+#     else
+        return;
+#     endif
+    }
+    if (backing == Backing::TransparentHugePages) {
+        // "always [madvise] never", MADV_HUGEPAGE is ignored with never.
+        std::string modes;
+        std::getline(std::ifstream("/sys/kernel/mm/transparent_hugepage/enabled"), modes);
+        if (modes.empty() || modes.find("[never]") != std::string::npos) {
+            return;
+        }
+        // mmap aligns to a normal page only, the huge pages need a 2 MiB boundary.
+        m_allocated_B += hugePage_B;
+    }
+    void* const allocation = mmap(nullptr, m_allocated_B, PROT_READ | PROT_WRITE, flags, -1, 0);
+    if (allocation == MAP_FAILED) {
+        return;
+    }
+    m_allocation = allocation;
+    void* address = allocation;
+    if (backing == Backing::TransparentHugePages) {
+        address = reinterpret_cast<void*>(
+            (reinterpret_cast<uintptr_t>(allocation) + hugePage_B - 1) & ~(hugePage_B - 1));
+    }
+    if (backing == Backing::Normal) {
+        // THP "always" would back the normal pages too.
+#     ifdef MADV_NOHUGEPAGE
+        m_mayUseHugePages = madvise(address, rounded_B, MADV_NOHUGEPAGE) != 0;
+#     else
+        m_mayUseHugePages = true;
+#     endif
+    }
+    if (backing == Backing::TransparentHugePages) {
+#     ifdef MADV_HUGEPAGE
+        if (madvise(address, rounded_B, MADV_HUGEPAGE) != 0) {
+            release();
+            return;
+        }
+#     else
+        release();
+        return;
+#     endif
+    }
+    if (numaNode >= 0) {
+#     ifdef SYS_mbind
+        constexpr int MPOL_BIND_ = 2;
+        constexpr uint32_t maskBits = sizeof(unsigned long) * 8;
+        unsigned long nodeMask[4] = {};
+        if (static_cast<uint32_t>(numaNode) >= maskBits * 4) {
+            release();
+            return;
+        }
+        nodeMask[numaNode / maskBits] = 1UL << (numaNode % maskBits);
+        if (syscall(SYS_mbind, address, rounded_B, MPOL_BIND_,
+                nodeMask, maskBits * 4 + 1, 0) != 0) {
+            release();
+            return;
+        }
+#     else
+        release();
+        return;
+#     endif
+    }
+    m_data = static_cast<uint8_t*>(address);
+#else
+    // Only normal pages of any node are supported.
+    if (backing != Backing::Normal || numaNode > 0) {
+        return;
+    }
+    constexpr size_t page_B = 4096;
+    m_allocated_B = size_B + page_B;
+    m_allocation = ::operator new(m_allocated_B);
+    m_data = reinterpret_cast<uint8_t*>(
+        (reinterpret_cast<uintptr_t>(m_allocation) + page_B - 1) & ~(page_B - 1));
+#endif // __linux__
+    m_size_B = size_B;
+    // Faults the pages in on the bound node.
+    std::memset(m_data, 0, m_size_B);
+}
+
+Benchmark::Buffer::Buffer(Buffer&& other) noexcept {
+    *this = std::move(other);
+}
+
+Benchmark::Buffer& Benchmark::Buffer::operator=(Buffer&& other) noexcept {
+    if (this != &other) {
+        release();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size_B, other.m_size_B);
+        std::swap(m_allocated_B, other.m_allocated_B);
+        std::swap(m_allocation, other.m_allocation);
+        std::swap(m_mayUseHugePages, other.m_mayUseHugePages);
+    }
+    return *this;
+}
+
+Benchmark::Buffer::~Buffer() {
+    release();
+}
+
+void Benchmark::Buffer::release() noexcept {
+    if (m_allocation != nullptr) {
+#     ifdef __linux__
+        munmap(m_allocation, m_allocated_B);
+#     else
+        ::operator delete(m_allocation);
+#     endif
+    }
+    m_data = nullptr;
+    m_size_B = 0;
+    m_allocated_B = 0;
+    m_allocation = nullptr;
+    m_mayUseHugePages = false;
+}
+
 // Input: 0..106 days in picoseconds
 // Output: 3..11 symbols
 //   d h m s ms us ns ps
@@ -570,6 +5913,47 @@ std::string Benchmark::makeDurationString(const int64_t duration_ps) {
     return result;
 }
 
+// Output: 1KiB, 1.5MiB, ...
+std::string Benchmark::makeSizeString(const uint64_t size_B) {
+    static const char* const units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+    uint32_t unitIdx = 0;
+    uint64_t unit_B = 1;
+    while (unitIdx + 1 < sizeof(units) / sizeof(units[0]) && size_B >= unit_B * 1024) {
+        unit_B *= 1024;
+        ++unitIdx;
+    }
+    std::ostringstream result;
+    if (size_B % unit_B == 0) {
+        result << size_B / unit_B;
+    }
+    else {
+        result << std::fixed << std::setprecision(1)
+            << static_cast<double>(size_B) / static_cast<double>(unit_B);
+    }
+    result << units[unitIdx];
+    return result.str();
+}
+
+// Output: 1.23 G<unit>/s, ...
+std::string Benchmark::makeRateString(const double perSecond, const char* unit) {
+    static const char* const prefixes[] = { "", "k", "M", "G", "T", "P" };
+    uint32_t prefixIdx = 0;
+    double value = perSecond;
+    while (prefixIdx + 1 < sizeof(prefixes) / sizeof(prefixes[0]) && value >= 1000.0) {
+        value /= 1000.0;
+        ++prefixIdx;
+    }
+    std::ostringstream result;
+    result << std::fixed << std::setprecision(value < 10.0 ? 2 : value < 100.0 ? 1 : 0)
+        << value << " " << prefixes[prefixIdx] << unit << "/s";
+    return result.str();
+}
+
+Benchmark::~Benchmark() {
+    closeSampleLog();
+    closeTimeline();
+}
+
 Benchmark::Benchmark() {
 #ifdef _WIN32
 # ifdef _M_ARM64
@@ -635,6 +6019,49 @@ std::string Benchmark::toString(const uint64_t value, const uint8_t width) {
     return result;
 }
 
+// | Name | Time |
+// |:-----|-----:|
+// | name | 123s |
+void Benchmark::printTable(const std::vector<std::string>& header,
+        const std::vector<std::vector<std::string>>& rows, const std::string& align) {
+    assert(align.size() == header.size());
+    std::vector<size_t> widths(header.size());
+    for (size_t idx = 0; idx < header.size(); ++idx) {
+        widths[idx] = header[idx].size();
+        for (const auto& row : rows) {
+            if (idx < row.size()) {
+                widths[idx] = std::max(widths[idx], row[idx].size());
+            }
+        }
+    }
+    const auto printRow = [&](const std::vector<std::string>& row) {
+        std::cout << "|";
+        for (size_t idx = 0; idx < header.size(); ++idx) {
+            std::cout << " " << std::setw(static_cast<int>(widths[idx])) << std::setfill(' ')
+                << (align[idx] == 'l' ? std::left : std::right)
+                << (idx < row.size() ? row[idx] : std::string()) << " |";
+        }
+        std::cout << "\n";
+    };
+    printRow(header);
+    std::cout << "|";
+    for (size_t idx = 0; idx < header.size(); ++idx) {
+        if (align[idx] == 'l') {
+            std::cout << ":" << std::string(widths[idx] + 1, '-') << "|";
+        }
+        else {
+            std::cout << std::string(widths[idx] + 1, '-') << ":|";
+        }
+    }
+    std::cout << "\n";
+    for (const auto& row : rows) {
+        printRow(row);
+    }
+}
+
+thread_local Benchmark::State* Benchmark::s_state = nullptr;
+thread_local Benchmark::Timeline* Benchmark::s_timeline = nullptr;
+
 #ifdef _WIN32
 # ifdef _M_ARM64
 uint64_t Benchmark::s_Hz = 0;